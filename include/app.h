@@ -1,11 +1,16 @@
 #pragma once
 
-#include <regex>
+#include <mutex>
 
 #include <ada.h>
 
 #include <raindrop.h>
 #include <raindrop_cache.h>
+#include <raindrop_queue.h>
+#include <collection_directory.h>
+#include <pattern_set.h>
+#include <scan_journal.h>
+#include <watcher.h>
 
 #include <mounts.h>
 
@@ -26,13 +31,26 @@ struct RunStats
     int excluded;
 };
 
+/// @brief A file of a mount that matched its patterns
+struct MountFile
+{
+    /** File name, used as the raindrop title */
+    std::string name;
+    /** Link of the raindrop for this file */
+    std::string link;
+};
+
 struct AppMount
 {
-    uint64_t collection_id;
+    std::string name;
+    uint64_t collection_id = 0;
     ada::url link_prefix;
     std::filesystem::path path;
     std::vector<std::string> tags;
-    std::vector<std::regex> patterns;
+    PatternSet patterns;
+    bool recursive;
+    /** Hash of the mount definition, so scan journals of a changed definition are not used */
+    std::string fingerprint;
 };
 
 
@@ -43,18 +61,34 @@ public:
     Result<void, ExecutionCode> run();
 private:
     Result<RunStats, ExecutionCode> execute_mount(const AppMount& appMount);
+    /// @brief Finds the files of a mount that match its patterns
+    /// @param journal Directories of a previous scan. Those unchanged since then are not listed again
+    /// and their files are counted as skipped. Replaced by the directories of this scan
+    std::vector<MountFile> scan_mount(const AppMount& appMount, ScanJournal& journal, RunStats& stats) const;
+    Result<void, ExecutionCode> sync_files(const AppMount& appMount, const std::vector<MountFile>& files, RaindropQueue& queue, RunStats& stats);
+    /// @brief Keeps syncing the files written to the mounts until SIGINT or SIGTERM is received
+    Result<void, ExecutionCode> watch(const std::vector<AppMount>& appMounts, DirectoryWatcher& watcher);
+    /// @brief Syncs files found by the watcher and uploads them right away
+    Result<void, ExecutionCode> flush_mount(const AppMount& appMount, const std::vector<MountFile>& files);
+    /// @brief Lets the raindrops created by a queue be found in the cache
+    void attach_cache(RaindropQueue& queue, uint64_t col);
+    /// @brief Checks a file against the patterns of its mount
+    /// @param relative_dir Directory of the file, relative to the mount path
+    /// @return The file and its link, or nothing when no pattern matches
+    static std::optional<MountFile> match_file(const AppMount& appMount, const std::filesystem::path& relative_dir, std::string_view name);
 public:
     Result<std::vector<AppMount>, ExecutionCode> check_config() const;
-    Result<AppMount, ExecutionCode> check_mount(const Mount& mount) const;
+    /// @param collections Collections of the account. Empty when there is no token to fetch them
+    Result<AppMount, ExecutionCode> check_mount(const Mount& mount, const CollectionDirectory& collections) const;
     static bool VERBOSE;
 private:
     Config config;
     RaindropAccount account;
     RaindropCache cache {account, 100};
+    /** Where scan journals are kept. Empty when they are disabled */
+    std::filesystem::path journal_dir;
 };
 
-using Raindrop = std::pair<std::string, uint64_t>;
-
 /// @brief Fetch the current raindrops inside the collection
 /// @param raindropio Raindrop account
 /// @param collection_id Id of the collection
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/// @brief Header of a binary collection cache file.
+///
+/// The file is laid out as this header followed by `entry_count` records of
+/// `{ uint64_t id; uint32_t link_size; char link[link_size]; }`, all in host byte order.
+struct SnapshotHeader
+{
+    static constexpr char magic_value[8] = { 'F', 'D', 'R', 'O', 'P', 'C', '\0', '\0' };
+    static constexpr uint32_t current_version = 2;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t collection;
+    /** Unix time (seconds) of the last complete sync with raindrop */
+    int64_t synced_at;
+    /** Highest raindrop id seen by the last complete sync. Ids created by folderdrop itself don't
+     * count, since raindrops created by others before them may not have been synced yet */
+    uint64_t newest_id;
+    uint64_t entry_count;
+};
+
+/// @brief Called for every entry read from a snapshot. The link is only valid during the call
+using SnapshotVisitor = std::function<void(std::string_view link, uint64_t id)>;
+
+/// @brief Reads a collection snapshot by mapping it into memory
+/// @param file The snapshot file
+/// @param collection Expected collection id. Snapshots of other collections are rejected
+/// @param synced_at Output for the time of the last sync stored in the snapshot
+/// @param newest_id Output for the highest raindrop id seen by the last sync
+/// @param visitor Receives every entry in the snapshot
+/// @return False when the file does not exist, is corrupted or was written by another version
+bool read_snapshot(const std::filesystem::path& file, uint64_t collection, int64_t& synced_at, uint64_t& newest_id, const SnapshotVisitor& visitor);
+
+/// @brief Writes a collection snapshot. The file is replaced atomically
+/// @param file The snapshot file. Parent directories are created when needed
+/// @param collection The collection id
+/// @param synced_at Time of the last sync
+/// @param newest_id Highest raindrop id seen by the last sync
+/// @param entry_count How many entries the producer will emit
+/// @param producer Must call the given visitor exactly entry_count times
+/// @return False when the file could not be written
+bool write_snapshot(const std::filesystem::path& file, uint64_t collection, int64_t synced_at, uint64_t newest_id, uint64_t entry_count,
+    const std::function<void(const SnapshotVisitor&)>& producer);
+
+/// @brief Directory used for cache files when none was configured. Follows XDG_CACHE_HOME
+/// @return The directory or an empty path when neither XDG_CACHE_HOME or HOME are defined
+std::filesystem::path default_cache_dir();
+
+/// @brief Stable, non-reversible key for a token, used to keep caches of different accounts apart
+/// @param token The account token
+/// @return Hexadecimal FNV-1a hash of the token
+std::string account_cache_key(std::string_view token);
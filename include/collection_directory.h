@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fele_error.h>
+#include <raindrop.h>
+
+enum class CollectionErrorCode
+{
+    fetch_error = 1,
+    no_such_collection,
+    /** More than one collection has the name. Its path tells them apart */
+    ambiguous
+};
+
+/// @brief Every collection of an account, fetched once and searchable by name.
+///
+/// A name is either the path of a collection, its title preceded by the titles of its parents
+/// separated by '/' ("Parent/Child"), or the title of a nested collection alone. Root collections
+/// win over nested ones with the same title.
+class CollectionDirectory
+{
+public:
+    /// @brief Fetches the root and nested collections of the account. Two requests in total
+    /// @param account The raindrop account
+    /// @return The directory
+    static Result<CollectionDirectory, CollectionErrorCode> load(const RaindropAccount& account);
+
+    /// @brief Builds a directory from get collections responses
+    /// @param roots Response of the get root collections endpoint
+    /// @param children Response of the get child collections endpoint
+    static CollectionDirectory from_responses(const nlohmann::json& roots, const nlohmann::json& children);
+
+    /// @brief Finds the id of a collection
+    /// @param name Path or title of the collection
+    /// @return The collection id
+    Result<uint64_t, CollectionErrorCode> find(const std::string& name) const;
+
+    size_t size() const { return titles.size(); }
+private:
+    struct Node
+    {
+        std::string title;
+        /** Id of the parent collection, 0 for root collections */
+        uint64_t parent;
+    };
+
+    std::string path_of(uint64_t id) const;
+private:
+    std::unordered_map<uint64_t, Node> titles;
+    /** Collections by path. Siblings may share a title, so a path may lead to many */
+    std::unordered_map<std::string, std::vector<uint64_t>> by_path;
+    /** Nested collections by title alone */
+    std::unordered_map<std::string, std::vector<uint64_t>> by_title;
+};
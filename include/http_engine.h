@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cpr/cpr.h>
+
+/// @brief Query parameters of a request, encoded when the request is sent
+using QueryParameters = std::vector<std::pair<std::string, std::string>>;
+
+/// @brief A request performed by HttpEngine
+struct HttpRequest
+{
+    enum class Method
+    {
+        get,
+        post
+    };
+
+    Method method = Method::get;
+    std::string url;
+    QueryParameters parameters;
+    /** Header lines, as in "Accept: application/json" */
+    std::vector<std::string> headers;
+    /** Sent as is, without being copied. Must stay valid until the request is done */
+    std::string_view body;
+};
+
+/// @brief Runs many HTTP requests at once on a single thread, with curl's multi interface.
+///
+/// Requests and timers can be handed over from any thread. Their callbacks run on the engine
+/// thread, so they must be short and must not block or throw: they typically fulfil a promise,
+/// or hand over another request. The thread is started by the first request.
+class HttpEngine
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void(cpr::Response)>;
+
+    /// @param share Share handle used by every transfer. May be null. It must not share the
+    /// connection cache: the multi handle keeps its own, which max_host_connections and
+    /// multiplexing rely on
+    /// @param max_host_connections Connections opened to a single host. Other requests wait
+    /// for one of them, or are multiplexed on it when HTTP/2 is used
+    explicit HttpEngine(CURLSH* share, long max_host_connections = 8);
+    HttpEngine(const HttpEngine&) = delete;
+    HttpEngine& operator=(const HttpEngine&) = delete;
+    /// @brief Stops the engine. Callbacks of unfinished requests and timers are dropped without being called
+    ~HttpEngine();
+
+    /// @brief Sends a request
+    /// @param request The request
+    /// @param done Receives the response. Failed transfers have status code 0 and an error
+    void perform(HttpRequest request, Callback done);
+
+    /// @brief Runs a task on the engine thread once the given time arrives
+    void schedule(Clock::time_point when, std::function<void()> task);
+private:
+    struct Transfer;
+
+    void wake_up(std::unique_lock<std::mutex>& lock);
+    void run();
+    void start(HttpRequest request, Callback done);
+    void finish(CURL* easy, CURLcode result);
+    static size_t write_body(char* data, size_t size, size_t count, void* user);
+    static size_t write_header(char* data, size_t size, size_t count, void* user);
+private:
+    CURLSH* share;
+    CURLM* multi;
+    std::thread thread;
+    /** Guards everything below */
+    std::mutex mutex;
+    bool stopping = false;
+    std::vector<std::pair<HttpRequest, Callback>> submitted;
+    std::vector<std::pair<Clock::time_point, std::function<void()>>> timers;
+    /** Transfers added to the multi handle. Only used by the engine thread */
+    std::unordered_map<CURL*, std::unique_ptr<Transfer>> running;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// @brief Memory compact map of links to raindrop ids.
+///
+/// Links are split at their last '/'. The directory part (prefix) is interned once, since almost
+/// every link of a mount shares the mount's link prefix, and only the remainder (suffix) is kept
+/// per entry inside a single arena. Lookups go through an open addressing table of entry indexes
+/// that hashes the prefix and suffix as if they were one string.
+class LinkStore
+{
+public:
+    using value_type = std::pair<std::string, uint64_t>;
+
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = LinkStore::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        const_iterator(const LinkStore* store, size_t index) : store(store), index(index) {}
+        /// @brief Builds the full link, so prefer LinkStore::for_each on hot paths
+        value_type operator*() const { return { std::string{ store->link_at(index) }, store->records[index].id }; }
+        const_iterator& operator++() { ++index; return *this; }
+        const_iterator operator++(int) { auto copy = *this; ++index; return copy; }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+    private:
+        const LinkStore* store;
+        size_t index;
+    };
+
+    /// @brief Adds a link. Nothing happens when the link is already stored
+    /// @return True if the link was added
+    bool insert(std::string_view link, uint64_t id);
+    /// @brief Adds a link or updates the id of an existing one
+    void insert_or_assign(std::string_view link, uint64_t id);
+    /// @brief Searches a link
+    /// @return The raindrop id, if the link is stored
+    std::optional<uint64_t> find(std::string_view link) const;
+    /// @brief Calls f(std::string_view link, uint64_t id) for every entry without allocating per entry
+    template<typename F>
+    void for_each(F&& f) const;
+
+    size_t size() const { return records.size(); }
+    bool empty() const { return records.empty(); }
+    void clear();
+    /// @brief Approximate number of bytes held by the store
+    size_t memory_usage() const;
+
+    const_iterator begin() const { return { this, 0 }; }
+    const_iterator end() const { return { this, records.size() }; }
+private:
+    struct Record
+    {
+        uint64_t id;
+        uint32_t prefix;
+        uint32_t suffix_offset;
+        uint32_t suffix_size;
+    };
+
+    static constexpr uint32_t empty_slot = 0;
+
+    uint32_t intern_prefix(std::string_view prefix);
+    std::string_view suffix_of(const Record& record) const;
+    std::string link_at(size_t index) const;
+    bool equals(const Record& record, std::string_view link) const;
+    uint64_t hash_of(const Record& record) const;
+    /// @return The slot holding the link, or the empty slot where it would be inserted
+    size_t probe(std::string_view link, uint64_t hash) const;
+    void grow();
+private:
+    /** Interned prefixes. A deque keeps the strings in place, so the views in prefix_ids stay valid */
+    std::deque<std::string> prefixes;
+    std::unordered_map<std::string_view, uint32_t> prefix_ids;
+    std::string suffixes;
+    std::vector<Record> records;
+    /** Open addressing table of record index + 1. Its size is always a power of two */
+    std::vector<uint32_t> slots;
+};
+
+template<typename F>
+void LinkStore::for_each(F&& f) const
+{
+    std::string link;
+    for (const auto& record : records)
+    {
+        link.assign(prefixes[record.prefix]).append(suffix_of(record));
+        f(std::string_view{ link }, record.id);
+    }
+}
@@ -6,6 +6,7 @@
 #include <optional>
 
 #include <fele_error.h>
+#include <scanner.h>
 
 struct Mount
 {
@@ -14,28 +15,48 @@ struct Mount
     std::optional<std::vector<std::string>> patterns;
     std::optional<std::string> collection;
     std::optional<std::string> link_prefix;
+    /** Also bookmark the files in subdirectories */
+    std::optional<bool> recursive;
 };
 
 using Mounts = std::unordered_map<std::string, Mount>;
 
 constexpr auto help_message = R"(Folderdrop: bookmark files in your computer to raindrop.io
 
-usage: folderdrop [-hvCd] -m mount1 [-pPtcl] ...
+usage: folderdrop [-hvCdw] -m mount1 [-pPtcl] ...
     options:
         -h, --help          show this message
         -v, --verbose       enables verbose logging
         -C, --config-file   load mount definitions from file
         -d, --dry-run       do not execute modifying actions
         -m, --mount         defines a new mount
+        -j, --jobs          number of mounts executed in parallel (default: 1)
+        --api-url           root of the raindrop api, e.g. a local emulator (default: https://api.raindrop.io)
+        --cache-dir         directory for the collection caches (default: $XDG_CACHE_HOME/folderdrop)
+        --no-cache          do not restore or save collection caches
+        --prefetch          number of collection pages to fetch concurrently (default: 0, one at a time)
+        --delta-sync        refresh cached collections by fetching only raindrops newer than the cache
+        --full-paging       never look up new files directly, always page through their collection
+        --scan-threads      number of threads walking recursive mounts (default: 0, one per hardware thread)
+        --scanner           how directories are listed: getdents (Linux only) or iterator (default: getdents)
+        --upload-jobs       number of batches uploaded in background while files are queued (default: 0, upload in place)
+        --gzip-uploads      send large request bodies gzip compressed
+        --full-scan         list every directory, even those unchanged since the last run
+        -w, --watch         keep running and sync files as they are written to the mounts (Linux only)
+        --watch-delay       milliseconds new files are collected before being synced in watch mode (default: 2000)
+        --cache-budget      memory budget in MiB for collection caches. Least recently used ones go to disk (default: 0, unlimited)
     mount definition:
         -p, --path          set mount path
         -P, --pattern       set a comma separated list of patterns to filter files
         -t, --tags          set a comma separated list of tags to put on created raindrops
         -c, --collection    set collection name
         -l, --link-prefix   set the prefix used for all links in raindrops
+        -r, --recursive     also bookmark files in subdirectories. Their links keep the path relative to the mount
     Environment variables:
         RD_TOKEN (required) token for your Raindrop.io account
         RD_VERBOSE          same as -v, --verbose
+        RD_CACHE_DIR        same as --cache-dir
+        RD_API_URL          same as --api-url
 )";
 
 namespace std
@@ -55,7 +76,9 @@ enum class LoadMountErrorCode
     /** A mount specific option is defined while no option was defined previously. Diag = option */
     option_missing_mount,
     /** Diag = option */
-    unknown_option
+    unknown_option,
+    /** The value given to an option can't be used. Diag = option=value */
+    invalid_value
 };
 
 class Config
@@ -67,6 +90,35 @@ public:
     bool is_verbose = false;
     bool show_help = false;
     bool dry_run = false;
+    /** Number of mounts executed in parallel */
+    int jobs = 1;
+    /** Root of the raindrop api. Empty for the default one */
+    std::string api_url;
+    /** Where collection caches are kept between runs. Empty for the default directory */
+    std::string cache_dir;
+    bool no_cache = false;
+    /** Maximum number of concurrent page requests while filling a collection cache */
+    int prefetch = 0;
+    /** Refresh cached collections newest first, stopping at the newest cached raindrop */
+    bool delta_sync = false;
+    /** Disables targeted lookups of new files */
+    bool full_paging = false;
+    /** Memory budget of the collection caches in MiB, 0 for unlimited */
+    int cache_budget = 0;
+    /** Maximum number of batches uploaded in the background, 0 to upload synchronously */
+    int upload_jobs = 0;
+    /** Threads walking the directories of a recursive mount, 0 for one per hardware thread */
+    int scan_threads = 0;
+    /** How mount directories are listed */
+    ScanBackend scanner = ScanBackend::getdents;
+    /** Compress large request bodies */
+    bool gzip_uploads = false;
+    /** List every directory again instead of skipping the ones unchanged since the last run */
+    bool full_scan = false;
+    /** Keep running after the first sync and sync new files as they are written */
+    bool watch = false;
+    /** Milliseconds between the first new file and the sync of the files written meanwhile */
+    int watch_delay = 2000;
 };
 
 /// @brief Load mounts from the command line
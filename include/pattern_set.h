@@ -0,0 +1,67 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief The patterns of a mount, answering whether a file name matches any of them.
+///
+/// Patterns are ECMAScript regular expressions that must match the whole name, as with
+/// std::regex_match and the match_not_bol and match_not_eol flags. Those made of literals, `.`,
+/// escapes like `\d`, brackets, groups, alternations and quantifiers are compiled together into
+/// a single DFA, so a name is checked in one pass over its bytes whatever the number of patterns.
+/// Patterns with anything else (backreferences, lookaheads, word boundaries, ...) are kept as
+/// std::regex and tried one after another when the DFA does not match. Because of the match
+/// flags, a pattern with the `^` or `$` anchors never matches.
+///
+/// Matching does not modify the set, so it can be shared by several threads.
+class PatternSet
+{
+public:
+    /** Most DFA states built before every pattern falls back to std::regex */
+    static constexpr size_t max_dfa_states = 1024;
+
+    PatternSet() = default;
+    /// @brief Compiles patterns
+    /// @throw std::regex_error When a pattern is not a valid ECMAScript regular expression
+    explicit PatternSet(const std::vector<std::string>& patterns);
+
+    /// @return True if the name matches at least one of the patterns
+    bool matches(std::string_view name) const;
+
+    /// @brief Number of patterns matched with std::regex instead of the DFA
+    size_t fallback_count() const { return fallbacks.size(); }
+private:
+    using ByteSet = std::bitset<256>;
+
+    /// @brief State of the combined NFA. It consumes a byte of its set to go to next, and moves
+    /// to any of the epsilon states without consuming anything
+    struct NfaState
+    {
+        int set = -1;
+        int next = -1;
+        std::vector<int> epsilon;
+    };
+
+    /// @brief Part of the NFA with a single entry and a single exit state
+    struct Fragment
+    {
+        int start;
+        int end;
+    };
+
+    class Parser;
+
+    bool build_dfa(const std::vector<NfaState>& nfa, const std::vector<ByteSet>& sets, int start, int accept);
+private:
+    /** Class of every byte. Bytes of a class go to the same state from any state */
+    uint8_t byte_class[256] = {};
+    size_t class_count = 0;
+    /** transitions[state * class_count + class]. State 0 is the dead state, 1 the start */
+    std::vector<uint32_t> transitions;
+    std::vector<bool> accepting;
+    std::vector<std::regex> fallbacks;
+};
@@ -3,14 +3,48 @@
 #include <vector>
 #include <nlohmann/json.hpp>
 #include <cpr/cpr.h>
+#include <future>
+#include <memory>
 #include <optional>
+#include <stdexcept>
+#include <string_view>
+
+#include <raindrop_http.h>
 
 /// @brief User account for raindrop
 struct RaindropAccount
 {
 public:
-    static const std::string base_url;
+    static const std::string default_base_url;
     std::string token;
+    /** Root of the raindrop api, without a trailing slash */
+    std::string base_url = default_base_url;
+    /** Client used by every request made for this account. Copies of the account share it */
+    std::shared_ptr<RaindropHttp> http = std::make_shared<RaindropHttp>();
+};
+
+/// @brief A request to raindrop that failed
+class RaindropError : public std::runtime_error
+{
+public:
+    RaindropError(const std::string& what, long status_code) : std::runtime_error(what), status(status_code) {}
+    /// @return The HTTP status of the response, 0 when no response came
+    long status_code() const { return status; }
+    /// @return Whether sending the request again may succeed
+    bool transient() const { return status == 0 || status == 429 || status >= 500; }
+private:
+    long status;
+};
+
+/// @brief A raindrop reduced to its link and id
+using Raindrop = std::pair<std::string, uint64_t>;
+
+/// @brief A page of raindrops reduced to what folderdrop needs
+struct RaindropPage
+{
+    /** Total number of raindrops reported by the api */
+    int count = 0;
+    std::vector<Raindrop> items;
 };
 
 /// @brief Builder for creating a payload for raindrop creation.
@@ -39,19 +73,34 @@ nlohmann::json create_raindrop(const RaindropAccount& raindropio, const nlohmann
 /// @param raindropio The raindrop account
 /// @param request Body of the request
 /// @return The response JSON
+/// @throws RaindropError When the request fails. Some of the raindrops may have been created anyway
 nlohmann::json create_raindrops(const RaindropAccount& raindropio, const nlohmann::json& request);
 
-/// @brief Searches for a collection in the raindrop account
-/// @param raindrop The raindrop account
-/// @param collection_name Name of the collection
-/// @return A pair with the first element being the collection, if it exists, and the second element as the entire api response
-std::optional<nlohmann::json> find_collection(const RaindropAccount& raindrop, const std::string& collection_name);
+/// @brief Creates several raindrops without blocking. Many requests may be in flight at once
+/// without a thread each
+/// @param raindropio The raindrop account
+/// @param request Body of the request
+/// @return The response JSON. Getting it throws like create_raindrops
+std::future<nlohmann::json> create_raindrops_async(const RaindropAccount& raindropio, const nlohmann::json& request);
+
+/// @brief Creates several raindrops from an already serialized request, without copying it
+/// @param raindropio The raindrop account
+/// @param body Serialized body of the request. Must stay valid until the returned future is ready
+/// @return The response JSON. Getting it throws like create_raindrops
+std::future<nlohmann::json> create_raindrops_async_view(const RaindropAccount& raindropio, std::string_view body);
+
+/// @brief Sends a create raindrops request from an already serialized body, without copying it.
+/// Unlike create_raindrops_async_view the response is left unchecked, so it can be polled
+/// @param raindropio The raindrop account
+/// @param body Serialized body of the request. Must stay valid until the returned future is ready
+/// @return The response. Check it with created_raindrops
+std::future<cpr::Response> send_raindrops_async_view(const RaindropAccount& raindropio, std::string_view body);
 
-/// @brief Searches for a collection inside the response
-/// @param response The response body for a get root or child collections endpoint
-/// @param collection_name Name of the collection
-/// @return A collection, if it exists
-std::optional<nlohmann::json> find_collection_in_response(nlohmann::json& response, const std::string& collection_name);
+/// @brief Checks the response of a create raindrops request
+/// @param response The response
+/// @return The response JSON
+/// @throws RaindropError When the request failed. Some of the raindrops may have been created anyway
+nlohmann::json created_raindrops(const cpr::Response& response);
 
 /// @brief Returns raindrops inside a collection. This is a paginated api
 /// @param radindropio The raindrop account
@@ -59,4 +108,18 @@ std::optional<nlohmann::json> find_collection_in_response(nlohmann::json& respon
 /// @param result Output vector that the results will be written to
 /// @param page The page to fetch results from
 /// @return True when there's more pages to be fetched
-bool get_raindrops(const RaindropAccount& radindropio, uint64_t id, std::vector<nlohmann::json>& result, int page = 0, int perpage = 10);
\ No newline at end of file
+bool get_raindrops(const RaindropAccount& radindropio, uint64_t id, std::vector<Raindrop>& result, int page = 0, int perpage = 10);
+
+/// @brief Fetches a page of raindrops inside a collection without blocking
+/// @param radindropio The raindrop account
+/// @param id Collection id
+/// @param page The page to fetch results from
+/// @return The page. Getting it throws std::runtime_error when the request failed
+std::future<RaindropPage> get_raindrops_async(const RaindropAccount& radindropio, uint64_t id, int page = 0, int perpage = 10);
+
+/// @brief Extracts the count and the link and _id of every item from a get raindrops response.
+/// The response is streamed through a SAX parser, so excerpts, covers, media, etc. are never built
+/// @param text The response body
+/// @param page Output page. Items are appended to it
+/// @return False when the response is not valid JSON
+bool parse_raindrop_page(std::string_view text, RaindropPage& page);
\ No newline at end of file
@@ -7,14 +7,21 @@
 #include <map>
 #include <optional>
 #include <vector>
+#include <filesystem>
+#include <mutex>
+#include <atomic>
 #include <fele_error.h>
+#include <link_store.h>
 
 template<typename T>
 struct FetchResult
 {
+    /** Page that follows this one, or -1 when this was the last page */
     int next_page;
     int perpage;
     std::vector<T> results;
+    /** Total number of records reported by the api */
+    int count;
 };
 
 enum class FindErrorCode
@@ -24,23 +31,136 @@ enum class FindErrorCode
     invalid_url = 3
 };
 
+/// @brief How a collection restored from a snapshot is brought up to date
+enum class SyncMode
+{
+    /** Fetch every raindrop updated since the last sync through a lastUpdate search */
+    changes,
+    /** Page newest first and stop at the newest raindrop already cached. Edited links are not picked */
+    delta
+};
+
+/// @brief How links missing from a partially fetched collection are settled
+enum class LookupStrategy
+{
+    /** Ask raindrop about the missing links directly when it takes less requests than paging */
+    adaptive,
+    /** Always page through the collection */
+    paging
+};
+
+/// @brief Cache of the raindrops of each collection, filled on demand.
+///
+/// Lookups and inserts are thread safe: each collection is locked while it is used, so different
+/// collections are fetched in parallel and a collection is never fetched twice at the same time.
+/// get_collection_caches and save_snapshots must only be used when no lookup is running.
 class RaindropCache
 {
 public:
     explicit RaindropCache(const RaindropAccount& account);
     RaindropCache(const RaindropAccount& account, int results_per_page);
+    RaindropCache(const RaindropCache&) = delete;
+    RaindropCache& operator=(const RaindropCache&) = delete;
+    ~RaindropCache();
     using Entry = std::pair<std::string, uint64_t>;
     struct Collection
     {
         int next_page_to_fetch = 0;
-        std::vector<Entry> entries;
+        /** Cached raindrops, indexed by link */
+        LinkStore entries;
+        /** Unix time of the last sync. Only meaningful once every page was fetched */
+        int64_t synced_at = 0;
+        /** Entries were restored from a snapshot and must be refreshed before being trusted */
+        bool needs_refresh = false;
+        /** Highest raindrop id seen by paging or refreshing the collection, which marks how far
+         * it was synced. Raindrop ids grow with creation time */
+        uint64_t newest_id = 0;
+        /** Size of the collection reported by the last fetched page, -1 while unknown */
+        int count = -1;
+        /** Entries were moved to spill_file to stay within the memory budget */
+        bool evicted = false;
+        std::filesystem::path spill_file;
+        /** Value of the cache use clock when the collection was last used. Guarded by collections_mutex */
+        uint64_t last_used = 0;
+        /** The snapshot was already looked for */
+        bool loaded = false;
+        /** Memory used by entries, readable without holding mutex */
+        std::atomic<size_t> memory{ 0 };
+        /** Guards everything else in the collection */
+        std::mutex mutex;
     };
+    /** Number of links checked by each targeted lookup request */
+    static constexpr size_t lookup_batch_size = 100;
     Result<Entry, FindErrorCode> find_by_link(const uint64_t col, const std::string& link);
+    /// @brief Searches several links at once. The collection is only fetched as far as needed to
+    /// settle every link that is not cached yet
+    /// @param col Collection id
+    /// @param links Links to search
+    /// @return The raindrop id of each link, in the same order, or nullopt when it does not exist
+    Result<std::vector<std::optional<uint64_t>>, FindErrorCode> find_by_links(const uint64_t col, const std::vector<std::string>& links);
     const std::map<uint64_t, Collection>& get_collection_caches() const { return collections; }
+    /// @brief Asks raindrop which of the links exist in the collection, even when the cache says
+    /// they don't. Used to find what a failed request created before it failed
+    /// @param col Collection id
+    /// @param links Links to search
+    /// @return The raindrop id of each link, in the same order, or nullopt when it does not exist
+    Result<std::vector<std::optional<uint64_t>>, FindErrorCode> reconcile(const uint64_t col, const std::vector<std::string>& links);
+    /// @brief Adds a raindrop that was just created, so later lookups don't need to fetch it
+    void insert(const uint64_t col, const std::string& link, uint64_t id);
+    /// @brief Enables persistent snapshots. Collections are restored from this directory the
+    /// first time they are used, and fully synced collections are written by save_snapshots
+    /// @param dir Directory holding the snapshots of the account
+    void set_snapshot_dir(std::filesystem::path dir) { snapshot_dir = std::move(dir); }
+    /// @brief Writes a snapshot for every fully synced collection
+    void save_snapshots() const;
+    /// @brief Enables prefetching. Once the size of a collection is known, all of its remaining
+    /// pages are fetched concurrently instead of one after another
+    /// @param max_in_flight Maximum number of concurrent requests. 0 disables prefetching
+    void set_prefetch(int max_in_flight) { prefetch_limit = max_in_flight; }
+    void set_sync_mode(SyncMode mode) { sync_mode = mode; }
+    void set_lookup_strategy(LookupStrategy strategy) { lookup_strategy = strategy; }
+    /// @brief Limits the memory held by collection caches. When exceeded, the least recently
+    /// used collections are written to disk and dropped from memory until they are used again
+    /// @param bytes The budget. 0 means unlimited
+    void set_memory_budget(size_t bytes) { memory_budget = bytes; }
 private:
-    Result<std::vector<Entry>, FindErrorCode> fetch_next_entries(const uint64_t col, int& next_page) const;
+    std::pair<Collection&, std::unique_lock<std::mutex>> lock_collection(const uint64_t col);
+    void restore(const uint64_t col, Collection& collection);
+    static void reset(Collection& collection);
+    void enforce_budget(const uint64_t in_use);
+    bool evict(const uint64_t col, Collection& collection);
+    void reload(const uint64_t col, Collection& collection);
+    Result<void, FindErrorCode> refresh(const uint64_t col, Collection& collection);
+    Result<void, FindErrorCode> fetch_missing(const uint64_t col, Collection& collection, const std::vector<std::string>& links,
+        std::vector<std::optional<uint64_t>>& ids, std::vector<size_t>& missing);
+    bool prefers_lookup(const Collection& collection, size_t missing) const;
+    Result<void, FindErrorCode> lookup_missing(const uint64_t col, Collection& collection, const std::vector<std::string>& links,
+        std::vector<std::optional<uint64_t>>& ids, std::vector<size_t>& missing);
+    Result<void, FindErrorCode> refresh_changes(const uint64_t col, Collection& collection, int& count);
+    Result<void, FindErrorCode> refresh_delta(const uint64_t col, Collection& collection, int& count);
+    static void merge(Collection& collection, const std::vector<Entry>& entries, bool overwrite);
+    Result<void, FindErrorCode> prefetch(const uint64_t col, Collection& collection, int count);
+    Result<FetchResult<Entry>, FindErrorCode> fetch_next_entries(const uint64_t col, int page, const std::string& search = {}, const std::string& sort = {}) const;
+    std::string page_url(const uint64_t col) const;
+    QueryParameters page_parameters(int page, const std::string& search = {}, const std::string& sort = {}) const;
+    Result<FetchResult<Entry>, FindErrorCode> parse_page(const cpr::Response& res, int page) const;
+    Result<int, FindErrorCode> fetch_collection_count(const uint64_t col) const;
+    Result<std::vector<uint64_t>, FindErrorCode> fetch_existing_ids(const std::vector<std::string>& links) const;
+    Result<std::pair<Entry, uint64_t>, FindErrorCode> fetch_raindrop(const uint64_t id) const;
+    std::filesystem::path snapshot_file(const uint64_t col) const;
 private:
     const int per_page;
     const RaindropAccount& account;
     std::map<uint64_t, Collection> collections;
+    std::filesystem::path snapshot_dir;
+    int prefetch_limit = 0;
+    SyncMode sync_mode = SyncMode::changes;
+    LookupStrategy lookup_strategy = LookupStrategy::adaptive;
+    size_t memory_budget = 0;
+    /** Guards the collections map and the use clock */
+    std::mutex collections_mutex;
+    uint64_t use_clock = 0;
+    /** Where evicted collections that can't be snapshots are written. Created by mkdtemp on the
+     * first such eviction, under collections_mutex, and removed on destruction */
+    std::filesystem::path spill_dir;
 };
\ No newline at end of file
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <optional>
+#include <vector>
+
+#include <cpr/cpr.h>
+
+#include <http_engine.h>
+
+/// @brief Token bucket that paces requests to the rate limit announced by raindrop.
+///
+/// The bucket starts with raindrop's documented limit (120 requests per minute) and is adjusted
+/// with the X-RateLimit-* headers of every response. When the limit is exhausted or a response
+/// asks to Retry-After, every request waits until the given time.
+class RateLimiter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr int default_limit = 120;
+    static constexpr std::chrono::seconds window{ 60 };
+
+    /// @brief Blocks until a request may be sent and takes a token for it
+    void acquire();
+    /// @brief Takes a token for a request if one is available
+    /// @return nullopt when the token was taken, otherwise when to try again
+    std::optional<Clock::time_point> try_acquire();
+    /// @brief Updates the limiter with the headers of a response
+    void observe(const cpr::Response& response);
+private:
+    void refill(Clock::time_point now);
+private:
+    std::mutex mutex;
+    int limit = default_limit;
+    double tokens = default_limit;
+    Clock::time_point last_refill = Clock::now();
+    Clock::time_point blocked_until{};
+};
+
+/// @brief Delay before retrying a failed request: exponential backoff with jitter
+/// @param attempt Number of retries already made
+/// @return Between half and all of 500ms * 2^attempt, capped at 30s
+std::chrono::milliseconds backoff_delay(int attempt);
+
+/// @brief Whether a response is a failure that may go away: network errors and server errors
+bool is_transient_failure(const cpr::Response& response);
+
+/// @brief Bytes moved by a RaindropHttp, before and after compression
+struct TransferStats
+{
+    /** Response bytes received over the wire */
+    uint64_t received = 0;
+    /** Response bytes once decompressed */
+    uint64_t received_decoded = 0;
+    /** Request body bytes sent over the wire */
+    uint64_t sent = 0;
+    /** Request body bytes before compression */
+    uint64_t sent_uncompressed = 0;
+
+    /** Bytes compression saved. Negative when it cost more than it saved */
+    int64_t saved() const { return static_cast<int64_t>(received_decoded + sent_uncompressed) - static_cast<int64_t>(received + sent); }
+};
+
+/// @brief HTTP client shared by every request made to raindrop.
+///
+/// Requests run on a pool of cpr sessions that are reused, so their connections are kept alive
+/// between requests. All sessions share one curl share handle, so DNS lookups and TLS sessions are
+/// reused across them too, and HTTP/2 is negotiated when the server offers it. Sessions are only
+/// used by one request at a time, which makes the client safe to use from several threads. The
+/// async variants run on an HttpEngine instead, so any number of them can be in flight without a
+/// thread each. Responses are requested gzip or deflate compressed. Every request goes through a
+/// shared RateLimiter, and requests rejected with 429 are sent again once the limit allows it. GET
+/// requests that fail with a transient failure are retried with backoff_delay.
+class RaindropHttp
+{
+public:
+    /** Times a request rejected by the rate limit is sent again before its response is returned */
+    static constexpr int max_rate_limited_retries = 5;
+    /** Times a GET request that failed with a transient failure is retried */
+    static constexpr int max_transient_retries = 4;
+    /** Request bodies smaller than this are not worth compressing */
+    static constexpr size_t min_compressed_body = 1024;
+
+    RaindropHttp();
+    RaindropHttp(const RaindropHttp&) = delete;
+    RaindropHttp& operator=(const RaindropHttp&) = delete;
+    ~RaindropHttp();
+
+    /// @brief Performs a GET request
+    /// @param url Full url of the endpoint
+    /// @param token Bearer token
+    /// @param parameters Query parameters
+    /// @return The response
+    cpr::Response get(const std::string& url, const std::string& token, const cpr::Parameters& parameters = {});
+
+    /// @brief Performs a POST request with a JSON body
+    /// @param url Full url of the endpoint
+    /// @param token Bearer token
+    /// @param body The request body
+    /// @return The response
+    cpr::Response post(const std::string& url, const std::string& token, std::string body);
+
+    /// @brief Performs a GET request without blocking
+    /// @param url Full url of the endpoint
+    /// @param token Bearer token
+    /// @param parameters Query parameters
+    /// @return The response, once every retry is done
+    std::future<cpr::Response> get_async(const std::string& url, const std::string& token, QueryParameters parameters = {});
+
+    /// @brief Performs a POST request with a JSON body without blocking
+    /// @param url Full url of the endpoint
+    /// @param token Bearer token
+    /// @param body The request body
+    /// @return The response, once every retry is done
+    std::future<cpr::Response> post_async(const std::string& url, const std::string& token, std::string body);
+
+    /// @brief Performs a POST request with a JSON body without blocking, and without copying the body
+    /// @param url Full url of the endpoint
+    /// @param token Bearer token
+    /// @param body The request body. Must stay valid until the returned future is ready
+    /// @return The response, once every retry is done
+    std::future<cpr::Response> post_async_view(const std::string& url, const std::string& token, std::string_view body);
+
+    /// @brief Waits on the engine, without blocking a thread
+    /// @param delay How long to wait
+    /// @return Ready once the delay is over
+    std::future<void> delay_async(std::chrono::milliseconds delay);
+
+    /// @brief Sends large request bodies gzip compressed. Only for servers that accept it
+    void set_compress_requests(bool enabled) { compress_requests = enabled; }
+    /// @return Bytes moved by every request made so far
+    TransferStats transfer_stats() const;
+private:
+    /// @brief Session borrowed from the pool, returned when destroyed
+    class Lease
+    {
+    public:
+        explicit Lease(RaindropHttp& http) : http(http), session(http.acquire()) {}
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease() { http.release(std::move(session)); }
+        cpr::Session& operator*() { return *session; }
+        cpr::Session* operator->() { return session.get(); }
+    private:
+        RaindropHttp& http;
+        std::unique_ptr<cpr::Session> session;
+    };
+
+    std::unique_ptr<cpr::Session> acquire();
+    void release(std::unique_ptr<cpr::Session> session);
+    void prepare(cpr::Session& session, const std::string& url, const std::string& token, const cpr::Parameters& parameters, bool gzip_body = false);
+    void record(const cpr::Response& response, size_t body_size, size_t sent_body_size);
+    static void lock_share(CURL* handle, curl_lock_data data, curl_lock_access access, void* user);
+    static void unlock_share(CURL* handle, curl_lock_data data, void* user);
+    template<typename Perform>
+    cpr::Response send(Perform&& perform, bool idempotent);
+    std::optional<std::chrono::milliseconds> retry_delay(const cpr::Response& response, bool idempotent, int& rate_limited, int& failed) const;
+    bool compress(std::string& body) const;
+
+    /// @brief A request on the engine, kept until its last retry
+    struct AsyncCall
+    {
+        HttpRequest request;
+        /** Body the request points to, unless it was borrowed from the caller */
+        std::string owned_body;
+        bool idempotent;
+        /** Size of the body before compression */
+        size_t body_size;
+        int rate_limited = 0;
+        int failed = 0;
+        std::promise<cpr::Response> promise;
+    };
+    std::future<cpr::Response> start(std::shared_ptr<AsyncCall> call, const std::string& token, bool gzip_body);
+    void dispatch(HttpEngine& engine, std::shared_ptr<AsyncCall> call);
+    HttpEngine& get_engine();
+private:
+    RateLimiter limiter;
+    CURLSH* share;
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> share_locks;
+    std::mutex pool_mutex;
+    std::vector<std::unique_ptr<cpr::Session>> idle_sessions;
+    bool compress_requests = false;
+    std::atomic<uint64_t> received{ 0 };
+    std::atomic<uint64_t> received_decoded{ 0 };
+    std::atomic<uint64_t> sent{ 0 };
+    std::atomic<uint64_t> sent_uncompressed{ 0 };
+    /** Created by the first async request. Must go before the share it uses */
+    std::unique_ptr<HttpEngine> engine;
+    std::mutex engine_mutex;
+};
@@ -6,23 +6,76 @@
 #include <raindrop.h>
 #include <nlohmann/json.hpp>
 #include <functional>
+#include <future>
+#include <list>
+#include <optional>
+#include <exception>
 
 class RaindropQueue
 {
 public:
     static constexpr int max_queue_size = 100;
-    RaindropQueue(const RaindropAccount& account, uint64_t collection_id, std::vector<std::string> tags);
+    /** Times a batch is sent before its failure is reported */
+    static constexpr int max_upload_attempts = 5;
+    /// @brief Removes the items of a batch that already exist and returns them as created raindrops
+    using ReplayFilter = std::function<nlohmann::json(nlohmann::json& batch)>;
+    /// @param max_in_flight When greater than 0, full batches are uploaded on the http engine while
+    /// new raindrops are appended, without a thread each. At most this many batches are in flight
+    /// at once. Responses and errors are then reported by the next append or offload
+    RaindropQueue(const RaindropAccount& account, uint64_t collection_id, std::vector<std::string> tags, int max_in_flight = 0);
     RaindropQueue(const RaindropQueue&) = delete;
     RaindropQueue& operator=(const RaindropQueue&) = delete;
+    /// @brief Uploads what is left in the queue. Errors are reported but not thrown
     ~RaindropQueue();
     std::optional<nlohmann::json> append(RaindropBuilder rd);
     std::optional<nlohmann::json> offload();
+    /// @brief Sets a function that receives every create raindrops response
+    void set_observer(std::function<void(nlohmann::json&)> fn) { observer = std::move(fn); }
+    /// @brief Sets the function consulted before a failed batch is sent again. A failed request
+    /// may have created part of the batch, and those must not be created twice. Called from the
+    /// thread that appends or offloads
+    void set_replay_filter(ReplayFilter fn) { replay_filter = std::move(fn); }
 private:
+    /// @brief A batch being uploaded, kept until its last attempt is over
+    struct Upload
+    {
+        Upload(nlohmann::json batch, std::string body) : batch(std::move(batch)), body(std::move(body)) {}
+
+        nlohmann::json batch;
+        /** The serialized batch. The request points to it, so it must outlive the response */
+        std::string body;
+        /** Raindrops that failed attempts created anyway */
+        nlohmann::json recovered = nlohmann::json::array();
+        int attempt = 0;
+        /** Response of the current attempt. Invalid until the batch is sent */
+        std::future<cpr::Response> response;
+        /** Ready once a failed batch may be sent again. Only valid while waiting for it */
+        std::future<void> retry;
+        /** Set once the batch is uploaded */
+        std::optional<nlohmann::json> result;
+    };
+
     void init_payload();
+    std::string take_buffer();
+    bool advance(Upload& upload, bool wait);
+    void send(Upload& upload) const;
+    nlohmann::json receive(Upload& upload) const;
+    void submit();
+    void drain(bool wait_oldest);
+    std::optional<nlohmann::json> collect(bool wait_all);
 private:
     const RaindropAccount& account;
     uint64_t collection_id;
     std::vector<std::string> tags;
     nlohmann::json payload;
     std::function<void(nlohmann::json&)> observer;
-};
\ No newline at end of file
+    ReplayFilter replay_filter;
+    /** Bodies of finished uploads, reused by the next ones */
+    std::vector<std::string> spare_buffers;
+
+    const int max_in_flight;
+    /** Batches being uploaded, oldest first. A list, so their bodies never move */
+    std::list<Upload> uploads;
+    std::vector<nlohmann::json> responses;
+    std::exception_ptr failure;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <scanner.h>
+
+/// @brief Header of a binary scan journal file.
+///
+/// The file is laid out as this header followed by `directory_count` records of
+/// `{ uint64_t device; uint64_t inode; int64_t mtime; uint32_t excluded; uint32_t subdir_count;
+/// uint32_t file_count; name path; name subdirs[subdir_count]; name files[file_count]; }`, where
+/// a name is `{ uint32_t size; char text[size]; }`, all in host byte order.
+struct JournalHeader
+{
+    static constexpr char magic_value[8] = { 'F', 'D', 'R', 'O', 'P', 'J', '\0', '\0' };
+    static constexpr uint32_t current_version = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    /** Fingerprint of the mount the journal was written for */
+    char fingerprint[16];
+    uint64_t directory_count;
+};
+
+/// @brief What a directory held the last time it was listed
+struct JournalDirectory
+{
+    DirectoryStamp stamp;
+    /** Names of the subdirectories. Only kept for recursive mounts */
+    std::vector<std::string> subdirs;
+    /** Names of the files that matched the mount's patterns and were confirmed to be in its collection */
+    std::vector<std::string> files;
+    /** Number of entries excluded by the patterns */
+    uint32_t excluded = 0;
+};
+
+/// @brief Directories of a mount that were fully synced by a previous run.
+///
+/// A directory whose stamp did not change since then still holds the same entries, so it does not
+/// need to be listed nor its files looked up again.
+class ScanJournal
+{
+public:
+    /// @brief Reads a journal, replacing the current content
+    /// @param file The journal file
+    /// @param fingerprint Fingerprint of the mount. Journals of other mount definitions are rejected
+    /// @return False when the file does not exist, is corrupted or belongs to another mount definition.
+    /// The journal is left empty
+    bool load(const std::filesystem::path& file, std::string_view fingerprint);
+
+    /// @brief Writes the journal. The file is replaced atomically
+    /// @param file The journal file. Parent directories are created when needed
+    /// @param fingerprint Fingerprint of the mount
+    /// @return False when the file could not be written
+    bool save(const std::filesystem::path& file, std::string_view fingerprint) const;
+
+    /// @brief Searches a directory
+    /// @param relative_dir The directory, relative to the mount path
+    /// @return The directory or null when it is not in the journal
+    const JournalDirectory* find(const std::filesystem::path& relative_dir) const;
+
+    void insert_or_assign(const std::filesystem::path& relative_dir, JournalDirectory directory);
+
+    size_t size() const { return directories.size(); }
+    bool empty() const { return directories.empty(); }
+    void clear() { directories.clear(); }
+private:
+    std::unordered_map<std::string, JournalDirectory> directories;
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief What an entry found by the walker is. Symbolic links are resolved for files only
+enum class EntryKind
+{
+    regular,
+    /** A directory. Links to directories are never walked, they are reported as other */
+    directory,
+    other
+};
+
+/// @brief How a DirectoryWalker lists directories
+enum class ScanBackend
+{
+    /** std::filesystem::directory_iterator, available everywhere */
+    iterator,
+    /** getdents64 on Linux. Entry types are read from the listing, without a stat call per entry,
+     * and names are handed out without copies. The iterator elsewhere */
+    getdents
+};
+
+/// @brief An entry of a walked directory
+struct ScanEntry
+{
+    /** Name of the entry. Only valid during the visit */
+    std::string_view name;
+    /** Directory holding the entry, relative to the root of the walk. Empty for the root itself */
+    const std::filesystem::path& relative_dir;
+    EntryKind kind;
+};
+
+/// @brief Receives the entries found by a DirectoryWalker
+/// @param worker Index of the walker thread making the call, below DirectoryWalker::thread_count
+using ScanVisitor = std::function<void(size_t worker, const ScanEntry& entry)>;
+
+/// @brief Identity and modification time of a directory. Adding, removing or renaming one of
+/// its entries changes the modification time
+struct DirectoryStamp
+{
+    uint64_t device;
+    uint64_t inode;
+    /** Modification time, in nanoseconds since the epoch */
+    int64_t mtime;
+
+    bool operator==(const DirectoryStamp& other) const
+    {
+        return device == other.device && inode == other.inode && mtime == other.mtime;
+    }
+    bool operator!=(const DirectoryStamp& other) const { return !(*this == other); }
+};
+
+/// @brief Decides whether a directory is listed. Called for every directory that is opened, from
+/// the thread that would list it, before its entries are visited
+/// @param worker Index of the walker thread making the call
+/// @param relative_dir The directory, relative to the root of the walk
+/// @param stamp The directory's stamp, taken before it is listed. Empty when it can't be read, in
+/// which case the directory is listed whatever the filter returns
+/// @param subdirs When the directory is not listed, receives its subdirectories so they are walked anyway
+/// @return True to list the directory
+using DirectoryFilter = std::function<bool(size_t worker, const std::filesystem::path& relative_dir,
+    const std::optional<DirectoryStamp>& stamp, std::vector<std::string>& subdirs)>;
+
+/// @brief Walks a directory tree on several threads.
+///
+/// Each thread owns a queue of directories to list. New subdirectories are pushed to the queue
+/// of the thread that found them and taken back newest first, so a thread stays in the same
+/// part of the tree. A thread with nothing left steals the oldest directory of another one,
+/// which is usually near the root and leads to plenty of work.
+class DirectoryWalker
+{
+public:
+    /// @param threads Number of walking threads. 0 for one per hardware thread
+    /// @param recursive Whether subdirectories are walked too. Without it only one thread is used
+    /// @param backend How directories are listed
+    DirectoryWalker(int threads, bool recursive, ScanBackend backend = ScanBackend::getdents);
+
+    /// @brief Walks a directory. Directories that can't be read are reported and skipped
+    /// @param root The directory
+    /// @param visit Called for every entry, directories included, from any of the walking threads
+    /// @return Number of directories that could not be read
+    size_t walk(const std::filesystem::path& root, const ScanVisitor& visit) const;
+
+    /// @brief Lets directories be skipped, e.g. when they did not change since the last walk.
+    /// Directories whose stamp can't be read are always listed, but still passed to the filter
+    void set_directory_filter(DirectoryFilter filter) { this->filter = std::move(filter); }
+
+    size_t thread_count() const { return threads; }
+private:
+    size_t threads;
+    bool recursive;
+    ScanBackend backend;
+    DirectoryFilter filter;
+};
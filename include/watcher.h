@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// @brief A file that was written or moved into a watched directory
+struct WatchEvent
+{
+    /** Index of the mount given to DirectoryWatcher::watch */
+    size_t mount;
+    /** Directory of the file, relative to the mount path */
+    std::filesystem::path relative_dir;
+    std::string name;
+};
+
+/// @brief Watches the directories of mounts for new files with inotify.
+///
+/// Only available on Linux, elsewhere the watcher is never valid. Subdirectories created in a
+/// recursive mount are watched as soon as they show up, and the files already in them are
+/// reported as events. Links to directories are not followed, like DirectoryWalker does.
+class DirectoryWatcher
+{
+public:
+    DirectoryWatcher();
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+    ~DirectoryWatcher();
+
+    /// @return False when inotify is not available
+    bool valid() const { return fd >= 0; }
+
+    /// @brief Watches a directory of a mount
+    /// @param mount Index of the mount, reported in its events
+    /// @param root The mount path
+    /// @param relative_dir The directory to watch, relative to the mount path
+    /// @param recursive Also watch every subdirectory
+    /// @param found Receives the files already in the watched directories. May be null
+    /// @return Number of directories that could not be watched
+    size_t watch(size_t mount, const std::filesystem::path& root, const std::filesystem::path& relative_dir,
+        bool recursive, std::vector<WatchEvent>* found);
+
+    /// @brief Waits for files to be written or moved into the watched directories
+    /// @param timeout Longest wait. It ends early when a signal is received
+    /// @param events Receives the new files
+    /// @return False when the kernel dropped events, so files may have been missed
+    bool wait(std::chrono::milliseconds timeout, std::vector<WatchEvent>& events);
+private:
+    struct Watched
+    {
+        size_t mount;
+        std::filesystem::path root;
+        std::filesystem::path relative_dir;
+        bool recursive;
+    };
+
+    bool add(const Watched& watched);
+    void remove_tree(size_t mount, const std::filesystem::path& relative_dir);
+private:
+    int fd = -1;
+    /** Watched directories by watch descriptor */
+    std::unordered_map<int, Watched> watches;
+};
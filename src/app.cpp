@@ -1,10 +1,17 @@
 #include "app.h"
 
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <map>
+#include <thread>
 
 #include <fmt/color.h>
 
-#include <raindrop_queue.h>
+#include <cache_snapshot.h>
+#include <scanner.h>
+#include <watcher.h>
 
 using namespace std::string_literals;
 namespace fs = std::filesystem;
@@ -17,38 +24,150 @@ bool is_verbose()
 
 bool App::VERBOSE = is_verbose();
 
+namespace
+{
+    volatile std::sig_atomic_t stop_requested = 0;
+
+    void request_stop(int)
+    {
+        stop_requested = 1;
+    }
+}
+
 App::App(Config config)
     : config(std::move(config))
 {
     auto rd_token = std::getenv("RD_TOKEN");
     if (rd_token != nullptr)
         account = RaindropAccount{ rd_token };
+
+    std::string api_url = this->config.api_url;
+    if (auto rd_api_url = std::getenv("RD_API_URL"); api_url.empty() && rd_api_url != nullptr)
+        api_url = rd_api_url;
+    while (!api_url.empty() && api_url.back() == '/')
+        api_url.pop_back();
+    if (!api_url.empty())
+        account.base_url = api_url;
+
+    if (!this->config.no_cache && !account.token.empty())
+    {
+        fs::path cache_dir = this->config.cache_dir;
+        if (auto rd_cache_dir = std::getenv("RD_CACHE_DIR"); cache_dir.empty() && rd_cache_dir != nullptr)
+            cache_dir = rd_cache_dir;
+        if (cache_dir.empty())
+            cache_dir = default_cache_dir();
+
+        if (!cache_dir.empty())
+        {
+            // caches of other endpoints (e.g. an emulator) must not mix with the real ones
+            const auto key = account.base_url == RaindropAccount::default_base_url
+                ? account_cache_key(account.token)
+                : account_cache_key(account.base_url + "\n" + account.token);
+            cache.set_snapshot_dir(cache_dir / key);
+            journal_dir = cache_dir / key;
+        }
+    }
+
+    account.http->set_compress_requests(this->config.gzip_uploads);
+
+    cache.set_prefetch(this->config.prefetch);
+    cache.set_sync_mode(this->config.delta_sync ? SyncMode::delta : SyncMode::changes);
+    cache.set_lookup_strategy(this->config.full_paging ? LookupStrategy::paging : LookupStrategy::adaptive);
+    cache.set_memory_budget(static_cast<size_t>(this->config.cache_budget) * 1024 * 1024);
 }
 
 Result<void, ExecutionCode> App::run()
 {
     OUTCOME_TRY(std::vector<AppMount> appMounts, check_config());
 
+    // watched before the first sync, so files written meanwhile are not missed
+    std::unique_ptr<DirectoryWatcher> watcher;
+    if (config.watch)
+    {
+        watcher = std::make_unique<DirectoryWatcher>();
+        if (!watcher->valid())
+            return Error{ExecutionCode::generic, std::string{"Watch mode is only available on Linux, with inotify"}};
+        for (size_t i = 0; i < appMounts.size(); i++)
+        {
+            if (watcher->watch(i, appMounts[i].path, {}, appMounts[i].recursive, nullptr) > 0)
+                std::cerr << "[WARNING] Some directories of mount " << appMounts[i].name << " are not watched" << std::endl;
+        }
+    }
+
+    // mounts are claimed in order by the workers. Like a sequential run, no
+    // mount is started after one failed
+    std::vector<std::optional<Result<RunStats, ExecutionCode>>> results(appMounts.size());
+    std::vector<std::exception_ptr> exceptions(appMounts.size());
+    std::atomic<size_t> next_mount{ 0 };
+    std::atomic<bool> failed{ false };
+
+    auto worker = [&]()
+    {
+        for (size_t i = next_mount++; i < appMounts.size() && !failed; i = next_mount++)
+        {
+            try
+            {
+                results[i] = execute_mount(appMounts[i]);
+                failed = failed || results[i]->has_error();
+            }
+            catch (...)
+            {
+                exceptions[i] = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+
+    const auto jobs = std::min<size_t>(std::max(config.jobs, 1), appMounts.size());
+    if (jobs <= 1)
+    {
+        worker();
+    }
+    else
+    {
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < jobs; i++)
+            workers.emplace_back(worker);
+        for (auto& w : workers)
+            w.join();
+    }
+
+    // stats are reported in mount order, whatever order the mounts finished in
     RunStats stats{ 0, 0, 0 };
-    for (const auto& appMount : appMounts)
+    for (size_t i = 0; i < appMounts.size(); i++)
     {
-        OUTCOME_TRY(auto stat, execute_mount(appMount));
+        if (exceptions[i])
+            std::rethrow_exception(exceptions[i]);
+        if (!results[i])
+            continue;
+
+        OUTCOME_TRY(auto stat, std::move(*results[i]));
         stats.created += stat.created;
         stats.excluded += stat.excluded;
         stats.skipped += stat.skipped;
 
-        std::cout << "Mount Stats: created " << stat.created << " / excluded " << stat.excluded << " / skipped " << stat.skipped << std::endl;
+        std::cout << "Mount Stats (" << appMounts[i].name << "): created " << stat.created << " / excluded " << stat.excluded << " / skipped " << stat.skipped << std::endl;
     }
 
     std::cout << "Run Stats: created " << stats.created << " / excluded " << stats.excluded << " / skipped " << stats.skipped << std::endl;
 
+    const auto transfer = account.http->transfer_stats();
+    std::cout << "Transfer Stats: received " << transfer.received << " bytes (" << transfer.received_decoded << " decoded) / sent "
+        << transfer.sent << " bytes (" << transfer.sent_uncompressed << " uncompressed) / saved " << transfer.saved() << " bytes" << std::endl;
+
+    cache.save_snapshots();
+
     std::ofstream cache_txt{"cache.txt"};
 
     for (const auto& [cl, cc] : cache.get_collection_caches())
     {
         cache_txt << "Cache for collection " << cl << " (stopped at page " << cc.next_page_to_fetch << ")" << std::endl;
 
-        if (cc.entries.empty())
+        if (cc.evicted)
+        {
+            cache_txt << "EVICTED to " << cc.spill_file << std::endl;
+        }
+        else if (cc.entries.empty())
         {
             cache_txt << "EMPTY" << std::endl;
         }
@@ -62,50 +181,357 @@ Result<void, ExecutionCode> App::run()
         
     }
 
+    if (watcher)
+        return watch(appMounts, *watcher);
+
+    return outcome::success();
+}
+
+Result<void, ExecutionCode> App::watch(const std::vector<AppMount> &appMounts, DirectoryWatcher &watcher)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+
+    const auto delay = std::chrono::milliseconds(config.watch_delay);
+    // files waiting for the next flush, by link so a file written twice is synced once
+    std::vector<std::map<std::string, MountFile>> pending(appMounts.size());
+    std::optional<Clock::time_point> flush_at;
+    std::vector<WatchEvent> events;
+
+    fmt::println("Watching {} mounts. Stop with Ctrl+C", appMounts.size());
+
+    while (!stop_requested)
+    {
+        auto timeout = std::chrono::milliseconds(1000);
+        if (flush_at)
+            timeout = std::clamp(std::chrono::ceil<std::chrono::milliseconds>(*flush_at - Clock::now()), std::chrono::milliseconds(0), timeout);
+
+        events.clear();
+        if (!watcher.wait(timeout, events))
+        {
+            std::cerr << "[WARNING] Too many changes at once, scanning every mount again" << std::endl;
+            for (size_t i = 0; i < appMounts.size(); i++)
+            {
+                // picks up directories created while events were lost
+                watcher.watch(i, appMounts[i].path, {}, appMounts[i].recursive, nullptr);
+
+                ScanJournal journal;
+                RunStats ignored{ 0, 0, 0 };
+                for (auto& file : scan_mount(appMounts[i], journal, ignored))
+                    pending[i].insert_or_assign(file.link, std::move(file));
+            }
+        }
+
+        for (const auto& event : events)
+        {
+            if (auto file = match_file(appMounts[event.mount], event.relative_dir, event.name))
+                pending[event.mount].insert_or_assign(file->link, std::move(*file));
+        }
+
+        const bool has_pending = std::any_of(pending.begin(), pending.end(), [](const auto& files) { return !files.empty(); });
+        if (!has_pending)
+        {
+            flush_at.reset();
+            continue;
+        }
+        if (!flush_at)
+            flush_at = Clock::now() + delay;
+        if (Clock::now() < *flush_at)
+            continue;
+
+        flush_at.reset();
+        for (size_t i = 0; i < appMounts.size(); i++)
+        {
+            if (pending[i].empty())
+                continue;
+
+            std::vector<MountFile> files;
+            files.reserve(pending[i].size());
+            for (auto& [link, file] : pending[i])
+                files.push_back(std::move(file));
+            pending[i].clear();
+
+            if (auto r = flush_mount(appMounts[i], files); r.has_error())
+            {
+                // the cache knows the raindrops created before the failure, so those are skipped next time
+                std::cerr << "[WARNING] Could not sync new files of mount " << appMounts[i].name << ", retrying: " << r.error().to_string() << std::endl;
+                for (auto& file : files)
+                    pending[i].insert_or_assign(file.link, std::move(file));
+            }
+        }
+    }
+
+    fmt::println("Stopped watching");
+    cache.save_snapshots();
+
+    return outcome::success();
+}
+
+Result<void, ExecutionCode> App::flush_mount(const AppMount &appMount, const std::vector<MountFile> &files)
+{
+    RunStats stats{ 0, 0, 0 };
+
+    try
+    {
+        RaindropQueue queue { account, appMount.collection_id, appMount.tags, config.upload_jobs };
+        attach_cache(queue, appMount.collection_id);
+
+        OUTCOME_TRY(sync_files(appMount, files, queue, stats));
+
+        if (auto r = queue.offload(); r.has_value())
+        {
+            stats.created += (*r)["items"].size();
+            log_created_raindrops(*r);
+        }
+    }
+    catch (const RaindropError& e)
+    {
+        return Error{ExecutionCode::generic, std::string{e.what()}};
+    }
+
+    std::cout << "Mount Stats (" << appMount.name << "): created " << stats.created << " / skipped " << stats.skipped << std::endl;
     return outcome::success();
 }
 
 Result<RunStats, ExecutionCode> App::execute_mount(const AppMount& appMount)
 {
-    const auto& [col, link_prefix, path, tags, patterns] = appMount;
-    RaindropQueue queue { account, col, tags };
+    RaindropQueue queue { account, appMount.collection_id, appMount.tags, config.upload_jobs };
     RunStats stats{ 0, 0, 0 };
 
-    for (auto const& dir_entry :fs::directory_iterator{path})
+    attach_cache(queue, appMount.collection_id);
+
+    ScanJournal journal;
+    const auto journal_file = journal_dir.empty()
+        ? fs::path{}
+        : journal_dir / ("scan-" + account_cache_key(appMount.name) + ".fdj");
+    if (!journal_file.empty() && !config.full_scan)
+        journal.load(journal_file, appMount.fingerprint);
+
+    const auto files = scan_mount(appMount, journal, stats);
+
+    OUTCOME_TRY(sync_files(appMount, files, queue, stats));
+
+    if (auto r = queue.offload(); r.has_value())
+    {
+        stats.created += (*r)["items"].size();
+        log_created_raindrops(*r);
+    }
+
+    // every file found is in the collection by now
+    if (!journal_file.empty() && !journal.empty() && !config.dry_run && !journal.save(journal_file, appMount.fingerprint))
+        std::cerr << "[WARNING] Could not write the scan journal " << journal_file << std::endl;
+
+    return stats;
+}
+
+void App::attach_cache(RaindropQueue &queue, uint64_t col)
+{
+    // other mounts of the same collection will find the raindrops created by this one
+    queue.set_observer([this, col](nlohmann::json& response)
+    {
+        for (const auto& item : response["items"])
+            cache.insert(col, item["link"].get<std::string>(), item["_id"].get<uint64_t>());
+    });
+
+    // before a failed batch is sent again, raindrop is asked which of its links exist by now
+    queue.set_replay_filter([this, col](nlohmann::json& batch)
     {
-        if (!dir_entry.is_regular_file())
+        auto& items = batch["items"];
+        std::vector<std::string> links;
+        for (const auto& item : items)
+            links.push_back(item["link"].get<std::string>());
+
+        auto ids = cache.reconcile(col, links);
+        if (ids.has_error())
+            throw RaindropError{ "Could not check which raindrops were created: " + ids.error().to_string(), 0 };
+
+        auto created = nlohmann::json::array();
+        auto pending = nlohmann::json::array();
+        for (size_t i = 0; i < links.size(); i++)
         {
-            if (VERBOSE)
-                std::cout << "Skipping non-regular file: " << dir_entry.path() << std::endl;
+            if (ids.value()[i])
+                created.push_back({ { "link", links[i] }, { "_id", *ids.value()[i] } });
+            else
+                pending.push_back(std::move(items[i]));
+        }
 
-            stats.excluded++;
-            continue;
+        items = std::move(pending);
+        return created;
+    });
+}
+
+std::vector<MountFile> App::scan_mount(const AppMount &appMount, ScanJournal &journal, RunStats &stats) const
+{
+    const auto& [name, col, link_prefix, path, tags, patterns, recursive, fingerprint] = appMount;
+    DirectoryWalker walker{ config.scan_threads, recursive, config.scanner };
+
+    /// @brief A directory listed by this scan
+    struct ListedDirectory
+    {
+        JournalDirectory directory;
+        /** Modified so recently that entries added in the same clock tick would go unnoticed */
+        bool racy;
+    };
+
+    // every walker thread has its own output, merged once the walk is over
+    std::vector<std::vector<MountFile>> found(walker.thread_count());
+    std::vector<int> excluded(walker.thread_count(), 0);
+    std::vector<int> skipped(walker.thread_count(), 0);
+    std::vector<std::unordered_map<std::string, ListedDirectory>> listed(walker.thread_count());
+    std::vector<std::vector<std::pair<fs::path, const JournalDirectory*>>> unchanged(walker.thread_count());
+    // entries of a directory are visited by the thread that listed it, right after the filter call
+    std::vector<JournalDirectory*> current(walker.thread_count(), nullptr);
+
+    const auto racy_after = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        (std::chrono::system_clock::now() - std::chrono::seconds(2)).time_since_epoch()).count();
+
+    walker.set_directory_filter([&](size_t worker, const fs::path& relative_dir, const std::optional<DirectoryStamp>& stamp, std::vector<std::string>& subdirs)
+    {
+        // without a stamp the directory can't be recognized next time, so it gets no record
+        if (!stamp)
+        {
+            current[worker] = nullptr;
+            return true;
         }
 
-        const auto file = dir_entry.path().filename().string();
-        auto match = std::find_if(patterns.begin(), patterns.end(), [&file](const std::regex& r)
+        if (const auto* known = journal.find(relative_dir); known != nullptr && known->stamp == *stamp)
         {
-            return std::regex_match(file, r, std::regex_constants::match_not_bol | std::regex_constants::match_not_eol);
-        });
+            subdirs = known->subdirs;
+            skipped[worker] += static_cast<int>(known->files.size());
+            excluded[worker] += static_cast<int>(known->excluded);
+            unchanged[worker].emplace_back(relative_dir, known);
+            return false;
+        }
+
+        auto& entry = listed[worker][relative_dir.generic_string()];
+        entry.directory.stamp = *stamp;
+        entry.racy = stamp->mtime >= racy_after;
+        current[worker] = &entry.directory;
+        return true;
+    });
+
+    const auto failures = walker.walk(path, [&](size_t worker, const ScanEntry& entry)
+    {
+        if (entry.kind == EntryKind::directory && recursive)
+        {
+            if (current[worker] != nullptr)
+                current[worker]->subdirs.emplace_back(entry.name);
+            return;
+        }
 
-        if (match == patterns.end())
+        if (entry.kind != EntryKind::regular)
         {
             if (VERBOSE)
-                std::cout << "[INFO] " << file << " not matched against patterns" << std::endl;
+                std::cout << "Skipping non-regular file: " << path / entry.relative_dir / entry.name << std::endl;
 
-            stats.excluded++;
-            continue;
+            excluded[worker]++;
+            if (current[worker] != nullptr)
+                current[worker]->excluded++;
+            return;
         }
 
-        auto link = link_prefix;
+        auto file = match_file(appMount, entry.relative_dir, entry.name);
+        if (!file)
+        {
+            excluded[worker]++;
+            if (current[worker] != nullptr)
+                current[worker]->excluded++;
+            return;
+        }
 
-        link.set_pathname( (fs::path{ link.get_pathname() } / dir_entry.path().filename()).string() );
+        if (current[worker] != nullptr)
+            current[worker]->files.push_back(file->name);
+        found[worker].push_back(std::move(*file));
+    });
 
-        const auto compiled_link = link.get_href();
+    if (failures > 0)
+        std::cerr << "[WARNING] " << failures << " directories of mount " << name << " could not be read" << std::endl;
 
-        auto find_result = cache.find_by_link(col, compiled_link);
-        
-        if (is_error(find_result, FindErrorCode::no_such_raindrop) )
+    std::vector<MountFile> files;
+    size_t unchanged_count = 0;
+    for (size_t i = 0; i < found.size(); i++)
+    {
+        stats.excluded += excluded[i];
+        stats.skipped += skipped[i];
+        unchanged_count += unchanged[i].size();
+        std::move(found[i].begin(), found[i].end(), std::back_inserter(files));
+    }
+
+    if (VERBOSE && unchanged_count > 0)
+        std::cout << "[INFO] " << unchanged_count << " unchanged directories of mount " << name << " were not listed" << std::endl;
+
+    // the next journal holds the unchanged directories and the ones listed now. The files of
+    // the latter are only confirmed once they are synced, so it must not be saved before that.
+    // An incomplete walk would make missing directories look empty, so it leaves no journal
+    ScanJournal next;
+    if (failures == 0)
+    {
+        for (const auto& dirs : unchanged)
+        {
+            for (const auto& [relative_dir, directory] : dirs)
+                next.insert_or_assign(relative_dir, *directory);
+        }
+        for (auto& dirs : listed)
+        {
+            for (auto& [relative_dir, entry] : dirs)
+            {
+                if (!entry.racy)
+                    next.insert_or_assign(relative_dir, std::move(entry.directory));
+            }
+        }
+    }
+    journal = std::move(next);
+
+    // the walk order depends on thread timing
+    std::sort(files.begin(), files.end(), [](const MountFile& a, const MountFile& b) { return a.link < b.link; });
+
+    return files;
+}
+
+std::optional<MountFile> App::match_file(const AppMount &appMount, const fs::path &relative_dir, std::string_view name)
+{
+    // matched on the view, only the files kept are copied
+    if (!appMount.patterns.matches(name))
+    {
+        if (VERBOSE)
+            std::cout << "[INFO] " << name << " not matched against patterns" << std::endl;
+
+        return std::nullopt;
+    }
+
+    std::string file{ name };
+    auto link = appMount.link_prefix;
+
+    link.set_pathname( (fs::path{ link.get_pathname() } / relative_dir / file).string() );
+
+    return MountFile{ std::move(file), std::string{ link.get_href() } };
+}
+
+Result<void, ExecutionCode> App::sync_files(const AppMount &appMount, const std::vector<MountFile> &files, RaindropQueue &queue, RunStats &stats)
+{
+    if (files.empty())
+        return outcome::success();
+
+    std::vector<std::string> links;
+    links.reserve(files.size());
+    std::transform(files.begin(), files.end(), std::back_inserter(links), [](const MountFile& f) { return f.link; });
+
+    auto find_result = cache.find_by_links(appMount.collection_id, links);
+
+    if (find_result.has_error())
+    {
+        return Error{ExecutionCode::generic, find_result.error().to_string()};
+    }
+
+    const auto& ids = find_result.value();
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        const auto& [file, compiled_link] = files[i];
+
+        if (!ids[i])
         {
             if (VERBOSE)
                 std::cout << "Will create " << compiled_link << std::endl;
@@ -115,27 +541,16 @@ Result<RunStats, ExecutionCode> App::execute_mount(const AppMount& appMount)
                 log_created_raindrops(*r);
             }
         }
-        else if (find_result.has_error())
-        {
-            return Error{ExecutionCode::generic, find_result.error().to_string()};
-        }
         else
         {
             if (VERBOSE)
-                std::cout << "[INFO] Skipping " << file << " because it already exists with id: " << find_result.value().second << std::endl;
+                std::cout << "[INFO] Skipping " << file << " because it already exists with id: " << *ids[i] << std::endl;
 
             stats.skipped++;
         }
     }
 
-    if (auto r = queue.offload(); r.has_value())
-    {
-        stats.created += (*r)["items"].size();
-        log_created_raindrops(*r);
-    }
-
-
-    return stats;
+    return outcome::success();
 }
 
 Result<std::vector<AppMount>, ExecutionCode> App::check_config() const
@@ -159,14 +574,25 @@ Result<std::vector<AppMount>, ExecutionCode> App::check_config() const
         fmt::println("{}\n\t{}", mount_name, std::to_string(m));
     }
 
+    // fetched once, however many mounts there are
+    CollectionDirectory collections;
+    if (!account.token.empty())
+    {
+        auto loaded = CollectionDirectory::load(account);
+        if (loaded.has_error())
+            return Error{ExecutionCode::generic, loaded.error().to_string()};
+        collections = std::move(loaded.value());
+    }
+
     for (const auto& [mount_name, m] : config.mounts)
     {
         fmt::println("Checking mount {}", fmt::styled(mount_name, fg(fmt::color::alice_blue) | fmt::emphasis::bold));
-        auto result = check_mount(m);
+        auto result = check_mount(m, collections);
         // Only build the AppMount when 
         if (!result.has_error())
         {
             appMounts.push_back(result.assume_value());
+            appMounts.back().name = mount_name;
             fmt::println("Mount {} is {}!",
                 fmt::styled(mount_name, fg(fmt::color::alice_blue) | fmt::emphasis::bold),
                 fmt::styled("OK", fg(fmt::color::green)));
@@ -183,7 +609,7 @@ Result<std::vector<AppMount>, ExecutionCode> App::check_config() const
     return appMounts;
 }
 
-Result<AppMount, ExecutionCode> App::check_mount(const Mount &mount) const
+Result<AppMount, ExecutionCode> App::check_mount(const Mount &mount, const CollectionDirectory &collections) const
 {
     AppMount appMount;
     bool error = false;
@@ -196,8 +622,15 @@ Result<AppMount, ExecutionCode> App::check_mount(const Mount &mount) const
     else if (!account.token.empty())
     {
         const auto collection_name = *mount.collection;
-        auto optCol = find_collection(account, collection_name);
-        if (!optCol)
+        auto collection = collections.find(collection_name);
+        if (collection.has_error() && collection.error().ecode == CollectionErrorCode::ambiguous)
+        {
+            fmt::println("[{}] Ambiguous collection: {}. Use its full path",
+                         fmt::styled("ERROR", fg(fmt::color::red)),
+                         collection.error().diag);
+            error = true;
+        }
+        else if (collection.has_error())
         {
             fmt::println("[{}] No such collection: {}",
                          fmt::styled("ERROR", fg(fmt::color::red)),
@@ -206,8 +639,7 @@ Result<AppMount, ExecutionCode> App::check_mount(const Mount &mount) const
         }
         else
         {
-            const auto collection = *optCol;
-            appMount.collection_id = collection["_id"].get<uint64_t>();
+            appMount.collection_id = collection.value();
         }
     }
 
@@ -244,11 +676,19 @@ Result<AppMount, ExecutionCode> App::check_mount(const Mount &mount) const
 
     if (mount.tags) appMount.tags = *mount.tags;
 
-    // Compile regexes
+    appMount.recursive = mount.recursive.value_or(false);
+
+    // everything deciding which files are found and where their raindrops are
+    std::string definition = appMount.path.string() + '\n' + std::to_string(appMount.collection_id) + '\n'
+        + std::string{ appMount.link_prefix.get_href() } + '\n' + (appMount.recursive ? "recursive" : "flat");
     for (const auto& pattern : mount.patterns.value_or(std::vector<std::string>{}))
-    {
-        appMount.patterns.emplace_back(pattern, std::regex::ECMAScript);
-    }
+        definition.append("\n").append(pattern);
+    appMount.fingerprint = account_cache_key(definition);
+
+    // Compile regexes
+    appMount.patterns = PatternSet{ mount.patterns.value_or(std::vector<std::string>{}) };
+    if (VERBOSE && appMount.patterns.fallback_count() > 0)
+        fmt::println("[INFO] {} patterns are matched with std::regex", appMount.patterns.fallback_count());
 
      if (error)
         return Error{ExecutionCode::malformed_mount_config, std::string{}};
@@ -261,23 +701,16 @@ std::vector<Raindrop> get_raindrops(const RaindropAccount &raindropio, uint64_t
     const auto perpage = 100;
     std::vector<Raindrop> vec;
     int current_page = 0;
-    std::vector<nlohmann::json> out_raindrops;
-    auto mapper = [](const nlohmann::json& rd) -> Raindrop
-    {
-        const auto link = rd["link"].get<std::string>();
-        const auto id = rd["_id"].get<uint64_t>();
-        
-        return {link, id};
-    };
+    std::vector<Raindrop> out_raindrops;
     auto has_more = get_raindrops(raindropio, collection_id, out_raindrops, current_page, perpage);
     ++current_page;
 
-    std::transform(out_raindrops.begin(), out_raindrops.end(), std::back_inserter(vec), mapper);
+    std::move(out_raindrops.begin(), out_raindrops.end(), std::back_inserter(vec));
 
     while (has_more)
     {
         has_more = get_raindrops(raindropio, collection_id, out_raindrops, current_page, perpage);
-        std::transform(out_raindrops.begin(), out_raindrops.end(), std::back_inserter(vec), mapper);
+        std::move(out_raindrops.begin(), out_raindrops.end(), std::back_inserter(vec));
         ++current_page;
     }
 
@@ -286,11 +719,13 @@ std::vector<Raindrop> get_raindrops(const RaindropAccount &raindropio, uint64_t
 
 void log_created_raindrops(const nlohmann::json &r)
 {
-    std::cout << "[INFO] Created raindrops:\n";
+    // written at once, so logs of mounts running in parallel don't interleave
+    std::string log = "[INFO] Created raindrops:\n";
     for (const auto &item : r["items"])
     {
         const auto id = item["_id"].get<uint64_t>();
-        std::cout << "\t- " << std::to_string(id) << '\n';
+        log.append("\t- ").append(std::to_string(id)).append("\n");
     }
+    std::cout << log;
     std::cout.flush();
 }
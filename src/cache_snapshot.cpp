@@ -0,0 +1,184 @@
+#include <cache_snapshot.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    /// @brief Read-only memory mapping of a whole file
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const fs::path& file)
+        {
+            const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return;
+
+            struct stat st;
+            if (::fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (addr != MAP_FAILED)
+                {
+                    data = static_cast<const char*>(addr);
+                    size = static_cast<size_t>(st.st_size);
+                    ::madvise(addr, size, MADV_SEQUENTIAL);
+                }
+            }
+            ::close(fd);
+        }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile()
+        {
+            if (data != nullptr)
+                ::munmap(const_cast<char*>(data), size);
+        }
+        const char* data = nullptr;
+        size_t size = 0;
+    };
+
+    template<typename T>
+    bool read_value(const char*& cursor, const char* end, T& value)
+    {
+        if (static_cast<size_t>(end - cursor) < sizeof(T))
+            return false;
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+
+    template<typename T>
+    void write_value(std::ofstream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+}
+
+bool read_snapshot(const fs::path &file, uint64_t collection, int64_t &synced_at, uint64_t &newest_id, const SnapshotVisitor &visitor)
+{
+    MappedFile mapped{ file };
+    if (mapped.data == nullptr)
+        return false;
+
+    const char* cursor = mapped.data;
+    const char* const end = mapped.data + mapped.size;
+
+    SnapshotHeader header;
+    if (!read_value(cursor, end, header)
+        || std::memcmp(header.magic, SnapshotHeader::magic_value, sizeof(header.magic)) != 0
+        || header.version != SnapshotHeader::current_version
+        || header.collection != collection)
+    {
+        return false;
+    }
+
+    // Validate the whole file before handing out any entry, so a truncated
+    // snapshot never leaves a half filled cache behind
+    const char* validate = cursor;
+    for (uint64_t i = 0; i < header.entry_count; i++)
+    {
+        uint64_t id;
+        uint32_t link_size;
+        if (!read_value(validate, end, id) || !read_value(validate, end, link_size)
+            || static_cast<size_t>(end - validate) < link_size)
+        {
+            return false;
+        }
+        validate += link_size;
+    }
+
+    for (uint64_t i = 0; i < header.entry_count; i++)
+    {
+        uint64_t id;
+        uint32_t link_size;
+        read_value(cursor, end, id);
+        read_value(cursor, end, link_size);
+        visitor(std::string_view{ cursor, link_size }, id);
+        cursor += link_size;
+    }
+
+    synced_at = header.synced_at;
+    newest_id = header.newest_id;
+    return true;
+}
+
+bool write_snapshot(const fs::path &file, uint64_t collection, int64_t synced_at, uint64_t newest_id, uint64_t entry_count,
+    const std::function<void(const SnapshotVisitor&)> &producer)
+{
+    std::error_code ec;
+    fs::create_directories(file.parent_path(), ec);
+    if (ec)
+        return false;
+
+    auto tmp_file = file;
+    tmp_file += ".tmp";
+
+    {
+        std::ofstream out{ tmp_file, std::ios::binary | std::ios::trunc };
+        if (!out.is_open())
+            return false;
+
+        SnapshotHeader header{};
+        std::memcpy(header.magic, SnapshotHeader::magic_value, sizeof(header.magic));
+        header.version = SnapshotHeader::current_version;
+        header.collection = collection;
+        header.synced_at = synced_at;
+        header.newest_id = newest_id;
+        header.entry_count = entry_count;
+        write_value(out, header);
+
+        uint64_t written = 0;
+        producer([&](std::string_view link, uint64_t id)
+        {
+            write_value(out, id);
+            write_value(out, static_cast<uint32_t>(link.size()));
+            out.write(link.data(), static_cast<std::streamsize>(link.size()));
+            written++;
+        });
+
+        if (!out || written != entry_count)
+        {
+            out.close();
+            fs::remove(tmp_file, ec);
+            return false;
+        }
+    }
+
+    fs::rename(tmp_file, file, ec);
+    return !ec;
+}
+
+fs::path default_cache_dir()
+{
+    if (auto xdg = std::getenv("XDG_CACHE_HOME"); xdg != nullptr && strlen(xdg) > 0)
+        return fs::path{ xdg } / "folderdrop";
+    if (auto home = std::getenv("HOME"); home != nullptr && strlen(home) > 0)
+        return fs::path{ home } / ".cache" / "folderdrop";
+    return {};
+}
+
+std::string account_cache_key(std::string_view token)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const char ch : token)
+    {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 1099511628211ull;
+    }
+
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string key(16, '0');
+    for (int i = 15; i >= 0; i--, hash >>= 4)
+        key[i] = digits[hash & 0xf];
+    return key;
+}
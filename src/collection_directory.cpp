@@ -0,0 +1,77 @@
+#include <collection_directory.h>
+
+Result<CollectionDirectory, CollectionErrorCode> CollectionDirectory::load(const RaindropAccount &account)
+{
+    auto roots = account.http->get(account.base_url + "/rest/v1/collections", account.token);
+    if (roots.status_code != 200)
+        return Error{CollectionErrorCode::fetch_error, "Error while fetching root collections: " + roots.text };
+
+    auto children = account.http->get(account.base_url + "/rest/v1/collections/childrens", account.token);
+    if (children.status_code != 200)
+        return Error{CollectionErrorCode::fetch_error, "Error while fetching nested collections: " + children.text };
+
+    return from_responses(nlohmann::json::parse(roots.text), nlohmann::json::parse(children.text));
+}
+
+CollectionDirectory CollectionDirectory::from_responses(const nlohmann::json &roots, const nlohmann::json &children)
+{
+    CollectionDirectory directory;
+
+    for (const auto& item : roots["items"])
+        directory.titles[item["_id"].get<uint64_t>()] = Node{ item["title"].get<std::string>(), 0 };
+
+    for (const auto& item : children["items"])
+    {
+        const auto parent = item.contains("parent") ? item["parent"]["$id"].get<uint64_t>() : 0;
+        directory.titles[item["_id"].get<uint64_t>()] = Node{ item["title"].get<std::string>(), parent };
+    }
+
+    // paths are built once every parent is known, whatever order the items came in
+    for (const auto& [id, node] : directory.titles)
+    {
+        directory.by_path[directory.path_of(id)].push_back(id);
+        if (node.parent != 0)
+            directory.by_title[node.title].push_back(id);
+    }
+
+    return directory;
+}
+
+Result<uint64_t, CollectionErrorCode> CollectionDirectory::find(const std::string &name) const
+{
+    const std::vector<uint64_t>* ids = nullptr;
+    if (auto path = by_path.find(name); path != by_path.end())
+        ids = &path->second;
+    else if (auto title = by_title.find(name); title != by_title.end())
+        ids = &title->second;
+    else
+        return Error{CollectionErrorCode::no_such_collection, name};
+
+    if (ids->size() > 1)
+    {
+        std::string paths;
+        for (const auto id : *ids)
+            paths += "\n\t" + path_of(id) + " (" + std::to_string(id) + ")";
+        return Error{CollectionErrorCode::ambiguous, name + " could be any of:" + paths};
+    }
+
+    return ids->front();
+}
+
+std::string CollectionDirectory::path_of(uint64_t id) const
+{
+    std::string path;
+
+    // the depth bound guards against a parent cycle in a malformed response
+    for (size_t depth = 0; depth <= titles.size(); depth++)
+    {
+        auto itr = titles.find(id);
+        if (itr == titles.end())
+            break;
+
+        path = path.empty() ? itr->second.title : itr->second.title + "/" + path;
+        id = itr->second.parent;
+    }
+
+    return path;
+}
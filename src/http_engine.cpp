@@ -0,0 +1,254 @@
+#include <http_engine.h>
+
+#include <algorithm>
+
+struct HttpEngine::Transfer
+{
+    Transfer(HttpRequest request, Callback done) : request(std::move(request)), done(std::move(done)), easy(curl_easy_init()) {}
+    Transfer(const Transfer&) = delete;
+    Transfer& operator=(const Transfer&) = delete;
+    ~Transfer()
+    {
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(easy);
+    }
+
+    HttpRequest request;
+    Callback done;
+    CURL* easy;
+    curl_slist* headers = nullptr;
+    std::string url;
+    cpr::Response response;
+};
+
+HttpEngine::HttpEngine(CURLSH* share, long max_host_connections)
+    : share(share),
+    multi(curl_multi_init())
+{
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, max_host_connections);
+}
+
+HttpEngine::~HttpEngine()
+{
+    {
+        std::unique_lock lock{ mutex };
+        stopping = true;
+        curl_multi_wakeup(multi);
+    }
+
+    if (thread.joinable())
+        thread.join();
+
+    for (auto& [easy, transfer] : running)
+        curl_multi_remove_handle(multi, easy);
+    running.clear();
+    curl_multi_cleanup(multi);
+}
+
+void HttpEngine::perform(HttpRequest request, Callback done)
+{
+    std::unique_lock lock{ mutex };
+    submitted.emplace_back(std::move(request), std::move(done));
+    wake_up(lock);
+}
+
+void HttpEngine::schedule(Clock::time_point when, std::function<void()> task)
+{
+    std::unique_lock lock{ mutex };
+    timers.emplace_back(when, std::move(task));
+    wake_up(lock);
+}
+
+void HttpEngine::wake_up(std::unique_lock<std::mutex>&)
+{
+    if (!thread.joinable())
+        thread = std::thread{ &HttpEngine::run, this };
+    else
+        curl_multi_wakeup(multi);
+}
+
+void HttpEngine::run()
+{
+    while (true)
+    {
+        std::vector<std::pair<HttpRequest, Callback>> requests;
+        std::vector<std::function<void()>> due;
+        auto next_timer = Clock::time_point::max();
+
+        {
+            std::lock_guard lock{ mutex };
+            if (stopping)
+                return;
+
+            requests.swap(submitted);
+
+            const auto now = Clock::now();
+            for (auto itr = timers.begin(); itr != timers.end(); )
+            {
+                if (itr->first <= now)
+                {
+                    due.push_back(std::move(itr->second));
+                    itr = timers.erase(itr);
+                }
+                else
+                {
+                    next_timer = std::min(next_timer, itr->first);
+                    ++itr;
+                }
+            }
+        }
+
+        // whatever these hand over wakes the poll below up right away
+        for (auto& task : due)
+            task();
+        for (auto& [request, done] : requests)
+            start(std::move(request), std::move(done));
+
+        int still_running = 0;
+        curl_multi_perform(multi, &still_running);
+
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(multi, &queued))
+        {
+            if (message->msg == CURLMSG_DONE)
+                finish(message->easy_handle, message->data.result);
+        }
+
+        int timeout_ms = 1000;
+        if (next_timer != Clock::time_point::max())
+        {
+            const auto until_timer = std::chrono::ceil<std::chrono::milliseconds>(next_timer - Clock::now()).count();
+            timeout_ms = static_cast<int>(std::clamp<long long>(until_timer, 0, timeout_ms));
+        }
+        curl_multi_poll(multi, nullptr, 0, timeout_ms, nullptr);
+    }
+}
+
+void HttpEngine::start(HttpRequest request, Callback done)
+{
+    auto transfer = std::make_unique<Transfer>(std::move(request), std::move(done));
+    auto easy = transfer->easy;
+    const auto& req = transfer->request;
+
+    transfer->url = req.url;
+    for (size_t i = 0; i < req.parameters.size(); i++)
+    {
+        const auto& [key, value] = req.parameters[i];
+        char* escaped_key = curl_easy_escape(easy, key.data(), static_cast<int>(key.size()));
+        char* escaped_value = curl_easy_escape(easy, value.data(), static_cast<int>(value.size()));
+        transfer->url += (i == 0 && req.url.find('?') == std::string::npos) ? '?' : '&';
+        transfer->url.append(escaped_key).append("=").append(escaped_value);
+        curl_free(escaped_key);
+        curl_free(escaped_value);
+    }
+
+    for (const auto& header : req.headers)
+        transfer->headers = curl_slist_append(transfer->headers, header.c_str());
+    // do not wait for a 100 Continue before sending large bodies
+    transfer->headers = curl_slist_append(transfer->headers, "Expect:");
+
+    curl_easy_setopt(easy, CURLOPT_URL, transfer->url.c_str());
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, transfer->headers);
+    if (share != nullptr)
+        curl_easy_setopt(easy, CURLOPT_SHARE, share);
+    curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+    curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, &HttpEngine::write_body);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, transfer.get());
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, &HttpEngine::write_header);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, transfer.get());
+
+    if (req.method == HttpRequest::Method::post)
+    {
+        curl_easy_setopt(easy, CURLOPT_POST, 1L);
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(req.body.size()));
+        // a null pointer would make curl read the body from a callback instead
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, req.body.empty() ? "" : req.body.data());
+    }
+
+    curl_multi_add_handle(multi, easy);
+    running.emplace(easy, std::move(transfer));
+}
+
+void HttpEngine::finish(CURL* easy, CURLcode result)
+{
+    curl_multi_remove_handle(multi, easy);
+
+    auto itr = running.find(easy);
+    if (itr == running.end())
+        return;
+    auto transfer = std::move(itr->second);
+    running.erase(itr);
+
+    auto& response = transfer->response;
+    char* effective_url = nullptr;
+    curl_easy_getinfo(easy, CURLINFO_EFFECTIVE_URL, &effective_url);
+    response.url = cpr::Url{ effective_url != nullptr ? effective_url : transfer->url };
+    curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME, &response.elapsed);
+    curl_off_t downloaded = 0;
+    curl_easy_getinfo(easy, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+    response.downloaded_bytes = downloaded;
+    curl_off_t uploaded = 0;
+    curl_easy_getinfo(easy, CURLINFO_SIZE_UPLOAD_T, &uploaded);
+    response.uploaded_bytes = uploaded;
+
+    if (result == CURLE_OK)
+    {
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &response.status_code);
+    }
+    else
+    {
+        // like cpr, a failed transfer has no status
+        response.status_code = 0;
+        switch (result)
+        {
+            case CURLE_COULDNT_CONNECT:
+            case CURLE_COULDNT_RESOLVE_HOST:
+                response.error.code = cpr::ErrorCode::CONNECTION_FAILURE;
+                break;
+            case CURLE_OPERATION_TIMEDOUT:
+                response.error.code = cpr::ErrorCode::OPERATION_TIMEDOUT;
+                break;
+            default:
+                response.error.code = cpr::ErrorCode::UNKNOWN_ERROR;
+                break;
+        }
+        response.error.message = curl_easy_strerror(result);
+    }
+
+    transfer->done(std::move(response));
+}
+
+size_t HttpEngine::write_body(char* data, size_t size, size_t count, void* user)
+{
+    static_cast<Transfer*>(user)->response.text.append(data, size * count);
+    return size * count;
+}
+
+size_t HttpEngine::write_header(char* data, size_t size, size_t count, void* user)
+{
+    auto& response = static_cast<Transfer*>(user)->response;
+    std::string_view line{ data, size * count };
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+        line.remove_suffix(1);
+
+    // a new status line starts the headers of another response, e.g. after a redirect
+    if (line.rfind("HTTP/", 0) == 0)
+    {
+        response.header.clear();
+        response.status_line = std::string{ line };
+    }
+    else if (const auto colon = line.find(':'); colon != std::string_view::npos)
+    {
+        auto value = line.substr(colon + 1);
+        while (!value.empty() && value.front() == ' ')
+            value.remove_prefix(1);
+        response.header[std::string{ line.substr(0, colon) }] = std::string{ value };
+    }
+
+    return size * count;
+}
@@ -0,0 +1,153 @@
+#include <link_store.h>
+
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint64_t fnv_offset = 14695981039346656037ull;
+    constexpr uint64_t fnv_prime = 1099511628211ull;
+
+    uint64_t fnv1a(std::string_view bytes, uint64_t hash = fnv_offset)
+    {
+        for (const char ch : bytes)
+        {
+            hash ^= static_cast<unsigned char>(ch);
+            hash *= fnv_prime;
+        }
+        return hash;
+    }
+
+    /// @brief Splits a link after its last '/'
+    std::pair<std::string_view, std::string_view> split_link(std::string_view link)
+    {
+        const auto slash = link.rfind('/');
+        if (slash == std::string_view::npos)
+            return { std::string_view{}, link };
+        return { link.substr(0, slash + 1), link.substr(slash + 1) };
+    }
+}
+
+bool LinkStore::insert(std::string_view link, uint64_t id)
+{
+    if ((records.size() + 1) * 4 > slots.size() * 3)
+        grow();
+
+    const auto slot = probe(link, fnv1a(link));
+    if (slots[slot] != empty_slot)
+        return false;
+
+    if (suffixes.size() + link.size() > std::numeric_limits<uint32_t>::max()
+        || records.size() + 1 >= std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error{ "LinkStore is full" };
+    }
+
+    const auto [prefix, suffix] = split_link(link);
+    records.push_back(Record{ id, intern_prefix(prefix), static_cast<uint32_t>(suffixes.size()), static_cast<uint32_t>(suffix.size()) });
+    suffixes.append(suffix);
+    slots[slot] = static_cast<uint32_t>(records.size());
+    return true;
+}
+
+void LinkStore::insert_or_assign(std::string_view link, uint64_t id)
+{
+    if (!insert(link, id))
+        records[slots[probe(link, fnv1a(link))] - 1].id = id;
+}
+
+std::optional<uint64_t> LinkStore::find(std::string_view link) const
+{
+    if (slots.empty())
+        return std::nullopt;
+
+    const auto slot = slots[probe(link, fnv1a(link))];
+    if (slot == empty_slot)
+        return std::nullopt;
+
+    return records[slot - 1].id;
+}
+
+void LinkStore::clear()
+{
+    prefixes.clear();
+    prefix_ids.clear();
+    suffixes.clear();
+    records.clear();
+    slots.clear();
+}
+
+size_t LinkStore::memory_usage() const
+{
+    size_t bytes = sizeof(*this)
+        + suffixes.capacity()
+        + records.capacity() * sizeof(Record)
+        + slots.capacity() * sizeof(uint32_t)
+        + prefix_ids.size() * (sizeof(std::string_view) + sizeof(uint32_t) + 2 * sizeof(void*));
+    for (const auto& prefix : prefixes)
+        bytes += sizeof(std::string) + prefix.capacity();
+    return bytes;
+}
+
+uint32_t LinkStore::intern_prefix(std::string_view prefix)
+{
+    if (auto itr = prefix_ids.find(prefix); itr != prefix_ids.end())
+        return itr->second;
+
+    const auto id = static_cast<uint32_t>(prefixes.size());
+    const auto& stored = prefixes.emplace_back(prefix);
+    prefix_ids.emplace(stored, id);
+    return id;
+}
+
+std::string_view LinkStore::suffix_of(const Record &record) const
+{
+    return std::string_view{ suffixes }.substr(record.suffix_offset, record.suffix_size);
+}
+
+std::string LinkStore::link_at(size_t index) const
+{
+    const auto& record = records[index];
+    std::string link = prefixes[record.prefix];
+    link.append(suffix_of(record));
+    return link;
+}
+
+bool LinkStore::equals(const Record &record, std::string_view link) const
+{
+    const std::string_view prefix = prefixes[record.prefix];
+    return link.size() == prefix.size() + record.suffix_size
+        && link.substr(0, prefix.size()) == prefix
+        && link.substr(prefix.size()) == suffix_of(record);
+}
+
+uint64_t LinkStore::hash_of(const Record &record) const
+{
+    return fnv1a(suffix_of(record), fnv1a(prefixes[record.prefix]));
+}
+
+size_t LinkStore::probe(std::string_view link, uint64_t hash) const
+{
+    const auto mask = slots.size() - 1;
+    for (auto slot = static_cast<size_t>(hash) & mask; ; slot = (slot + 1) & mask)
+    {
+        if (slots[slot] == empty_slot || equals(records[slots[slot] - 1], link))
+            return slot;
+    }
+}
+
+void LinkStore::grow()
+{
+    std::vector<uint32_t> grown(slots.empty() ? 64 : slots.size() * 2, empty_slot);
+    const auto mask = grown.size() - 1;
+
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        auto slot = static_cast<size_t>(hash_of(records[i])) & mask;
+        while (grown[slot] != empty_slot)
+            slot = (slot + 1) & mask;
+        grown[slot] = static_cast<uint32_t>(i + 1);
+    }
+
+    slots = std::move(grown);
+}
@@ -23,7 +23,7 @@ int main(int argc, char* argv[])
         if (run.error().ecode == ExecutionCode::no_such_collection)
         {
             std::cerr << "[ERROR] Could not find collection named '" << run.error().diag << "' in your account!\n"
-                << "Currently only top level (root) collection can be used!" << std::endl;
+                << "Nested collections are found by title or by path, as in 'Parent/Child'" << std::endl;
         }
         else
         {
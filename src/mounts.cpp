@@ -7,6 +7,7 @@
 #include <cstring>
 #include <iostream>
 #include <string_view>
+#include <charconv>
 
 #include <mounts.h>
 #include <string_utils.h>
@@ -97,6 +98,19 @@ Result<std::string, LoadMountErrorCode> consume_option_value(std::vector<std::st
     }
 }
 
+Result<int, LoadMountErrorCode> consume_count_option_value(const std::vector<std::string>& args, std::vector<std::string>::iterator& current)
+{
+    const auto option = *current;
+    OUTCOME_TRY(auto value, consume_option_value(args, current));
+
+    int count = 0;
+    const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), count);
+    if (ec != std::errc{} || end != value.data() + value.size() || count < 0)
+        return Error{LoadMountErrorCode::invalid_value, option + "=" + value};
+
+    return count;
+}
+
 Result<Mounts, LoadMountErrorCode> load_mount_cmd(std::vector<std::string>::iterator arg_itr, std::vector<std::string>::iterator end)
 {
     Mounts mounts;
@@ -140,6 +154,11 @@ Result<Mounts, LoadMountErrorCode> load_mount_cmd(std::vector<std::string>::iter
             if (mount == mounts.end()) Error{LoadMountErrorCode::option_missing_mount, a};
             OUTCOME_TRY(mount->second.link_prefix, consume_option_value(arg_itr, end));
         }
+        else if (a == "-r" || a == "--recursive")
+        {
+            if (mount == mounts.end()) return Error{LoadMountErrorCode::option_missing_mount, a};
+            mount->second.recursive = true;
+        }
         else
         {
             return Error{LoadMountErrorCode::unknown_option, a};
@@ -205,6 +224,8 @@ Result<Mounts, LoadMountErrorCode> load_mount_config(const std::string_view file
                 mount->second.collection = value;
             else if (option == "link_prefix")
                 mount->second.link_prefix = value;
+            else if (option == "recursive" && (value == "true" || value == "false"))
+                mount->second.recursive = value == "true";
             else
                 throw std::runtime_error{ "Unknown option: '" + line + "' defined at line " + std::to_string(line_no) + "." };
         }
@@ -226,7 +247,8 @@ std::string std::to_string(const Mount &mount)
     return "Mount{path=" + opt_to_string(mount.path)
         + "; tags=" + (mount.tags ? join(*mount.tags) : "empty")
         + "; patterns=" + (mount.patterns ? join(*mount.patterns) : "empty")
-        + "; collection=" + opt_to_string(mount.collection) + "}";
+        + "; collection=" + opt_to_string(mount.collection)
+        + "; recursive=" + (mount.recursive ? (*mount.recursive ? "true" : "false") : "empty") + "}";
 }
 
 
@@ -264,6 +286,70 @@ Result<Config, LoadMountErrorCode> Config::load_config(int argc, char **argv)
         {
             config.dry_run = true;
         }
+        else if (test_option(a, "-j", "--jobs"))
+        {
+            OUTCOME_TRY(config.jobs, consume_count_option_value(args, arg_itr));
+        }
+        else if (a == "--api-url")
+        {
+            OUTCOME_TRY(config.api_url, consume_option_value(args, arg_itr));
+        }
+        else if (a == "--cache-dir")
+        {
+            OUTCOME_TRY(config.cache_dir, consume_option_value(args, arg_itr));
+        }
+        else if (a == "--no-cache")
+        {
+            config.no_cache = true;
+        }
+        else if (a == "--prefetch")
+        {
+            OUTCOME_TRY(config.prefetch, consume_count_option_value(args, arg_itr));
+        }
+        else if (a == "--delta-sync")
+        {
+            config.delta_sync = true;
+        }
+        else if (a == "--full-paging")
+        {
+            config.full_paging = true;
+        }
+        else if (a == "--cache-budget")
+        {
+            OUTCOME_TRY(config.cache_budget, consume_count_option_value(args, arg_itr));
+        }
+        else if (a == "--upload-jobs")
+        {
+            OUTCOME_TRY(config.upload_jobs, consume_count_option_value(args, arg_itr));
+        }
+        else if (a == "--scan-threads")
+        {
+            OUTCOME_TRY(config.scan_threads, consume_count_option_value(args, arg_itr));
+        }
+        else if (a == "--scanner")
+        {
+            OUTCOME_TRY(auto value, consume_option_value(args, arg_itr));
+            auto scanner = magic_enum::enum_cast<ScanBackend>(value);
+            if (!scanner)
+                return Error{LoadMountErrorCode::invalid_value, a + "=" + value};
+            config.scanner = *scanner;
+        }
+        else if (a == "--gzip-uploads")
+        {
+            config.gzip_uploads = true;
+        }
+        else if (a == "--full-scan")
+        {
+            config.full_scan = true;
+        }
+        else if (test_option(a, "-w", "--watch"))
+        {
+            config.watch = true;
+        }
+        else if (a == "--watch-delay")
+        {
+            OUTCOME_TRY(config.watch_delay, consume_count_option_value(args, arg_itr));
+        }
         else if (test_option(a, "-m", "--mount"))
         {
             // When we hit the first -m, stop immediately to
@@ -302,6 +388,7 @@ Result<Config, LoadMountErrorCode> Config::load_config(int argc, char **argv)
             if (mount.patterns) prev->second.patterns = *mount.patterns;
             if (mount.tags) prev->second.tags = *mount.tags;
             if (mount.link_prefix) prev->second.link_prefix = *mount.link_prefix;
+            if (mount.recursive) prev->second.recursive = *mount.recursive;
         }
     }
 
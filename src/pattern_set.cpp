@@ -0,0 +1,565 @@
+#include <pattern_set.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <optional>
+
+namespace
+{
+    /** Repetition counts above this are left to std::regex, as every repetition copies the NFA of its atom */
+    constexpr size_t max_repetitions = 64;
+    constexpr size_t unbounded = static_cast<size_t>(-1);
+    /** Nested repetitions multiply the NFA size. Patterns growing it past this are left to std::regex */
+    constexpr size_t max_nfa_states = 16384;
+
+    constexpr auto match_flags = std::regex_constants::match_not_bol | std::regex_constants::match_not_eol;
+
+    bool is_digit(unsigned char ch) { return ch >= '0' && ch <= '9'; }
+    bool is_alnum(unsigned char ch) { return is_digit(ch) || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'); }
+    bool is_quantifier(char ch) { return ch == '*' || ch == '+' || ch == '?' || ch == '{'; }
+
+    /// @brief Bytes of the class escapes \d, \w and \s, as std::regex sees them in the C locale
+    std::optional<std::bitset<256>> class_escape(char escape)
+    {
+        std::bitset<256> set;
+        switch (escape)
+        {
+            case 'd': case 'D':
+                for (int ch = '0'; ch <= '9'; ch++)
+                    set.set(ch);
+                break;
+            case 'w': case 'W':
+                for (int ch = 0; ch < 128; ch++)
+                    set.set(ch, is_alnum(static_cast<unsigned char>(ch)) || ch == '_');
+                break;
+            case 's': case 'S':
+                for (const char ch : { ' ', '\t', '\n', '\v', '\f', '\r' })
+                    set.set(static_cast<unsigned char>(ch));
+                break;
+            default:
+                return std::nullopt;
+        }
+
+        if (escape == 'D' || escape == 'W' || escape == 'S')
+            set.flip();
+        return set;
+    }
+
+    /// @brief Byte of the control escapes \f, \n, \r, \t and \v
+    std::optional<unsigned char> control_escape(char escape)
+    {
+        switch (escape)
+        {
+            case 'f': return '\f';
+            case 'n': return '\n';
+            case 'r': return '\r';
+            case 't': return '\t';
+            case 'v': return '\v';
+            default: return std::nullopt;
+        }
+    }
+}
+
+/// @brief Recursive descent parser of the supported ECMAScript subset, building Thompson NFA fragments.
+///
+/// Anything outside the subset, or that std::regex could read differently, makes the whole
+/// pattern unsupported rather than risking a different meaning.
+class PatternSet::Parser
+{
+public:
+    Parser(std::string_view pattern, std::vector<NfaState>& nfa, std::vector<ByteSet>& sets)
+        : pattern(pattern), nfa(nfa), sets(sets) {}
+
+    /// @return The fragment of the whole pattern, or nothing when it is not supported
+    std::optional<Fragment> parse()
+    {
+        auto fragment = disjunction();
+        if (!fragment || pos != pattern.size())
+            return std::nullopt;
+        return fragment;
+    }
+private:
+    std::optional<Fragment> disjunction()
+    {
+        auto fragment = alternative();
+        while (fragment && pos < pattern.size() && pattern[pos] == '|')
+        {
+            pos++;
+            auto other = alternative();
+            if (!other)
+                return std::nullopt;
+            fragment = alternate(*fragment, *other);
+        }
+        return fragment;
+    }
+
+    std::optional<Fragment> alternative()
+    {
+        auto fragment = empty();
+        while (pos < pattern.size() && pattern[pos] != '|' && pattern[pos] != ')')
+        {
+            auto next = term();
+            if (!next)
+                return std::nullopt;
+            fragment = concat(fragment, *next);
+        }
+        return fragment;
+    }
+
+    std::optional<Fragment> term()
+    {
+        const auto atom_start = pos;
+        auto fragment = atom();
+        if (!fragment || pos == pattern.size() || !is_quantifier(pattern[pos]))
+            return fragment;
+
+        size_t min = 0, max = unbounded;
+        switch (pattern[pos])
+        {
+            case '*': pos++; break;
+            case '+': min = 1; pos++; break;
+            case '?': max = 1; pos++; break;
+            default:
+                if (!braces(min, max))
+                    return std::nullopt;
+                break;
+        }
+
+        // a lazy quantifier finds a different match, but matches the same names
+        if (pos < pattern.size() && pattern[pos] == '?')
+            pos++;
+        if (pos < pattern.size() && is_quantifier(pattern[pos]))
+            return std::nullopt;
+
+        return repeat(*fragment, atom_start, min, max);
+    }
+
+    /// @brief Reads {n}, {n,} or {n,m}
+    bool braces(size_t& min, size_t& max)
+    {
+        pos++;
+        if (!number(min))
+            return false;
+        max = min;
+        if (pos < pattern.size() && pattern[pos] == ',')
+        {
+            pos++;
+            max = unbounded;
+            if (pos < pattern.size() && pattern[pos] != '}' && !number(max))
+                return false;
+        }
+        if (pos >= pattern.size() || pattern[pos] != '}')
+            return false;
+        pos++;
+
+        return min <= max && min <= max_repetitions && (max == unbounded || max <= max_repetitions);
+    }
+
+    bool number(size_t& value)
+    {
+        const auto start = pos;
+        value = 0;
+        while (pos < pattern.size() && is_digit(pattern[pos]) && pos - start < 4)
+            value = value * 10 + static_cast<size_t>(pattern[pos++] - '0');
+        return pos > start && (pos >= pattern.size() || !is_digit(pattern[pos]));
+    }
+
+    std::optional<Fragment> atom()
+    {
+        const auto ch = static_cast<unsigned char>(pattern[pos]);
+        switch (ch)
+        {
+            case '.':
+            {
+                pos++;
+                ByteSet set;
+                set.set();
+                set.reset('\n');
+                set.reset('\r');
+                return single(set);
+            }
+            case '(':
+            {
+                pos++;
+                if (pos < pattern.size() && pattern[pos] == '?')
+                {
+                    // only non capturing groups, lookaheads are assertions
+                    if (pos + 1 >= pattern.size() || pattern[pos + 1] != ':')
+                        return std::nullopt;
+                    pos += 2;
+                }
+                auto fragment = disjunction();
+                if (!fragment || pos >= pattern.size() || pattern[pos] != ')')
+                    return std::nullopt;
+                pos++;
+                return fragment;
+            }
+            case '[':
+                return bracket();
+            case '\\':
+                return escape();
+            case '^': case '$': case ')': case '*': case '+': case '?': case '{': case '}': case ']': case '|':
+                return std::nullopt;
+            default:
+            {
+                pos++;
+                ByteSet set;
+                set.set(ch);
+                return single(set);
+            }
+        }
+    }
+
+    std::optional<Fragment> escape()
+    {
+        pos++;
+        if (pos >= pattern.size())
+            return std::nullopt;
+
+        const auto ch = static_cast<unsigned char>(pattern[pos++]);
+        ByteSet set;
+        if (auto escaped = class_escape(ch))
+            set = *escaped;
+        else if (auto control = control_escape(ch))
+            set.set(*control);
+        // backreferences, \b, \B, \c, \x, \u, \0... are left to std::regex
+        else if (ch < 128 && !is_alnum(ch))
+            set.set(ch);
+        else
+            return std::nullopt;
+
+        return single(set);
+    }
+
+    std::optional<Fragment> bracket()
+    {
+        pos++;
+        const bool negated = pos < pattern.size() && pattern[pos] == '^';
+        if (negated)
+            pos++;
+        // [] and [^] have meanings of their own
+        if (pos >= pattern.size() || pattern[pos] == ']')
+            return std::nullopt;
+
+        ByteSet set;
+        bool after_range = false;
+        while (pos < pattern.size() && pattern[pos] != ']')
+        {
+            ByteSet atom_set;
+            std::optional<unsigned char> first;
+            if (!class_atom(atom_set, first))
+                return std::nullopt;
+
+            const bool is_range = pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']';
+            if (!is_range)
+            {
+                // a '-' right after a range, as in [a-c-e], is read differently across implementations
+                if (after_range && first == '-')
+                    return std::nullopt;
+                set |= atom_set;
+                after_range = false;
+                continue;
+            }
+
+            pos++;
+            ByteSet last_set;
+            std::optional<unsigned char> last;
+            if (!first || !class_atom(last_set, last) || !last)
+                return std::nullopt;
+            // ranges are compared as chars, whose sign is up to the platform
+            if (*first >= 128 || *last >= 128 || *first > *last)
+                return std::nullopt;
+            for (unsigned ch = *first; ch <= *last; ch++)
+                set.set(ch);
+            after_range = true;
+        }
+
+        if (pos >= pattern.size())
+            return std::nullopt;
+        pos++;
+
+        if (negated)
+            set.flip();
+        return single(set);
+    }
+
+    /// @brief Reads a byte or a class escape inside brackets
+    /// @param byte The byte, when the atom is not a class escape
+    bool class_atom(ByteSet& set, std::optional<unsigned char>& byte)
+    {
+        const auto ch = static_cast<unsigned char>(pattern[pos++]);
+        // [:alpha:], [.a.] and [=a=] are classes of their own
+        if (ch == '[')
+            return false;
+        if (ch != '\\')
+        {
+            set.set(ch);
+            byte = ch;
+            return true;
+        }
+
+        if (pos >= pattern.size())
+            return false;
+        const auto escaped = static_cast<unsigned char>(pattern[pos++]);
+        if (auto class_set = class_escape(escaped))
+        {
+            set = *class_set;
+            return true;
+        }
+        if (auto control = control_escape(escaped))
+            byte = *control;
+        // \b is a backspace within brackets, left to std::regex with the other letters
+        else if (escaped < 128 && !is_alnum(escaped))
+            byte = escaped;
+        else
+            return false;
+
+        set.set(*byte);
+        return true;
+    }
+
+    std::optional<Fragment> repeat(Fragment fragment, size_t atom_start, size_t min, size_t max)
+    {
+        // every repetition needs its own states, built by reading the atom again
+        auto copy = [&]() -> std::optional<Fragment>
+        {
+            const auto saved = pos;
+            pos = atom_start;
+            auto again = atom();
+            pos = saved;
+            return again;
+        };
+
+        auto result = empty();
+        std::optional<Fragment> next = fragment;
+        const auto count = max == unbounded ? min + 1 : max;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (nfa.size() > max_nfa_states || (!next && !(next = copy())))
+                return std::nullopt;
+
+            if (i < min)
+                result = concat(result, *next);
+            else if (max == unbounded)
+                result = concat(result, star(*next));
+            else
+                result = concat(result, optional(*next));
+            next.reset();
+        }
+        return result;
+    }
+
+    int add_state()
+    {
+        nfa.emplace_back();
+        return static_cast<int>(nfa.size() - 1);
+    }
+
+    Fragment empty()
+    {
+        const auto state = add_state();
+        return { state, state };
+    }
+
+    Fragment single(const ByteSet& set)
+    {
+        const auto start = add_state();
+        const auto end = add_state();
+        sets.push_back(set);
+        nfa[start].set = static_cast<int>(sets.size() - 1);
+        nfa[start].next = end;
+        return { start, end };
+    }
+
+    Fragment concat(Fragment first, Fragment second)
+    {
+        nfa[first.end].epsilon.push_back(second.start);
+        return { first.start, second.end };
+    }
+
+    Fragment alternate(Fragment first, Fragment second)
+    {
+        const auto start = add_state();
+        const auto end = add_state();
+        nfa[start].epsilon = { first.start, second.start };
+        nfa[first.end].epsilon.push_back(end);
+        nfa[second.end].epsilon.push_back(end);
+        return { start, end };
+    }
+
+    Fragment star(Fragment fragment)
+    {
+        const auto start = add_state();
+        const auto end = add_state();
+        nfa[start].epsilon = { fragment.start, end };
+        nfa[fragment.end].epsilon.push_back(fragment.start);
+        nfa[fragment.end].epsilon.push_back(end);
+        return { start, end };
+    }
+
+    Fragment optional(Fragment fragment)
+    {
+        const auto start = add_state();
+        const auto end = add_state();
+        nfa[start].epsilon = { fragment.start, end };
+        nfa[fragment.end].epsilon.push_back(end);
+        return { start, end };
+    }
+private:
+    std::string_view pattern;
+    size_t pos = 0;
+    std::vector<NfaState>& nfa;
+    std::vector<ByteSet>& sets;
+};
+
+PatternSet::PatternSet(const std::vector<std::string> &patterns)
+{
+    std::vector<NfaState> nfa(1);
+    std::vector<ByteSet> sets;
+    std::vector<std::regex> compiled;
+    std::vector<int> exits;
+
+    for (const auto& pattern : patterns)
+    {
+        // built even for the DFA, so invalid patterns are rejected exactly as before
+        std::regex regex{ pattern, std::regex::ECMAScript };
+
+        const auto nfa_size = nfa.size();
+        const auto sets_size = sets.size();
+        if (auto fragment = Parser{ pattern, nfa, sets }.parse())
+        {
+            nfa[0].epsilon.push_back(fragment->start);
+            exits.push_back(fragment->end);
+            compiled.push_back(std::move(regex));
+        }
+        else
+        {
+            nfa.resize(nfa_size);
+            sets.resize(sets_size);
+            fallbacks.push_back(std::move(regex));
+        }
+    }
+
+    if (compiled.empty())
+        return;
+
+    const auto accept = static_cast<int>(nfa.size());
+    nfa.emplace_back();
+    for (const auto exit : exits)
+        nfa[exit].epsilon.push_back(accept);
+
+    if (!build_dfa(nfa, sets, 0, accept))
+    {
+        transitions.clear();
+        accepting.clear();
+        std::move(compiled.begin(), compiled.end(), std::back_inserter(fallbacks));
+    }
+}
+
+bool PatternSet::build_dfa(const std::vector<NfaState> &nfa, const std::vector<ByteSet> &sets, int start, int accept)
+{
+    // bytes no set tells apart share a class, which keeps the table small
+    std::fill(std::begin(byte_class), std::end(byte_class), 0);
+    class_count = 1;
+    for (const auto& set : sets)
+    {
+        std::map<std::pair<int, bool>, int> refined;
+        for (int ch = 0; ch < 256; ch++)
+        {
+            const auto key = std::make_pair(static_cast<int>(byte_class[ch]), static_cast<bool>(set[ch]));
+            const auto id = refined.emplace(key, static_cast<int>(refined.size())).first->second;
+            byte_class[ch] = static_cast<uint8_t>(id);
+        }
+        class_count = refined.size();
+    }
+
+    std::vector<int> representative(class_count, -1);
+    for (int ch = 255; ch >= 0; ch--)
+        representative[byte_class[ch]] = ch;
+
+    // epsilon closure, keeping only the states that consume a byte or accept
+    std::vector<char> seen(nfa.size());
+    std::vector<int> stack;
+    auto closure = [&](std::vector<int> states)
+    {
+        std::fill(seen.begin(), seen.end(), 0);
+        std::vector<int> kept;
+        stack = std::move(states);
+        while (!stack.empty())
+        {
+            const auto state = stack.back();
+            stack.pop_back();
+            if (seen[state])
+                continue;
+            seen[state] = 1;
+            if (nfa[state].set >= 0 || state == accept)
+                kept.push_back(state);
+            for (const auto next : nfa[state].epsilon)
+                stack.push_back(next);
+        }
+        std::sort(kept.begin(), kept.end());
+        return kept;
+    };
+
+    std::map<std::vector<int>, uint32_t> ids;
+    std::vector<std::vector<int>> states;
+    auto add = [&](std::vector<int> nfa_states)
+    {
+        auto [itr, inserted] = ids.emplace(nfa_states, static_cast<uint32_t>(states.size()));
+        if (inserted)
+        {
+            accepting.push_back(std::binary_search(nfa_states.begin(), nfa_states.end(), accept));
+            states.push_back(std::move(nfa_states));
+        }
+        return itr->second;
+    };
+
+    accepting.clear();
+    add({});
+    add(closure({ start }));
+
+    for (size_t current = 1; current < states.size(); current++)
+    {
+        if (states.size() > max_dfa_states)
+            return false;
+
+        transitions.resize(states.size() * class_count, 0);
+        for (size_t cls = 0; cls < class_count; cls++)
+        {
+            std::vector<int> moved;
+            for (const auto state : states[current])
+            {
+                if (nfa[state].set >= 0 && sets[nfa[state].set][representative[cls]])
+                    moved.push_back(nfa[state].next);
+            }
+            // add may grow states, so the row is written through its index
+            const auto target = moved.empty() ? 0 : add(closure(std::move(moved)));
+            transitions[current * class_count + cls] = target;
+        }
+    }
+
+    transitions.resize(states.size() * class_count, 0);
+    return states.size() <= max_dfa_states;
+}
+
+bool PatternSet::matches(std::string_view name) const
+{
+    if (!transitions.empty())
+    {
+        uint32_t state = 1;
+        for (const char ch : name)
+        {
+            state = transitions[state * class_count + byte_class[static_cast<unsigned char>(ch)]];
+            if (state == 0)
+                break;
+        }
+        if (accepting[state])
+            return true;
+    }
+
+    return std::any_of(fallbacks.begin(), fallbacks.end(), [name](const std::regex& r)
+    {
+        return std::regex_match(name.begin(), name.end(), r, match_flags);
+    });
+}
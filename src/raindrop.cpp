@@ -2,7 +2,7 @@
 
 #include <fmt/core.h>
 
-const std::string RaindropAccount::base_url = "https://api.raindrop.io";
+const std::string RaindropAccount::default_base_url = "https://api.raindrop.io";
 
 RaindropBuilder::RaindropBuilder(const std::string &url)
     : body({
@@ -55,11 +55,7 @@ nlohmann::json &RaindropBuilder::get_json()
 
 nlohmann::json create_raindrop(const RaindropAccount &raindropio, const nlohmann::json& request)
 {
-    auto r = cpr::Post(cpr::Url{ RaindropAccount::base_url + "/rest/v1/raindrop/" },
-        cpr::Bearer{ raindropio.token },
-        cpr::Header{{ "Content-Type", "application/json" }},
-        cpr::Header{{ "Accept", "application/json" }},
-        cpr::Body{request.dump()});
+    auto r = raindropio.http->post(raindropio.base_url + "/rest/v1/raindrop/", raindropio.token, request.dump());
 
     if (r.status_code != 200)
     {
@@ -69,71 +65,196 @@ nlohmann::json create_raindrop(const RaindropAccount &raindropio, const nlohmann
     return nlohmann::json::parse(r.text);
 }
 
-nlohmann::json create_raindrops(const RaindropAccount &raindropio, const nlohmann::json& request)
+nlohmann::json created_raindrops(const cpr::Response& r)
 {
-    auto r = cpr::Post(cpr::Url{ RaindropAccount::base_url + "/rest/v1/raindrops/" },
-        cpr::Bearer{ raindropio.token },
-        cpr::Header{{ "Content-Type", "application/json" }},
-        cpr::Header{{ "Accept", "application/json" }},
-        cpr::Body{request.dump()});
-
     if (r.status_code != 200)
     {
-        throw std::runtime_error{ "Error creating multiple raindrops: " + r.text };
+        throw RaindropError{ "Error creating multiple raindrops: " + (r.error ? r.error.message : r.text), r.status_code };
     }
 
     return nlohmann::json::parse(r.text);
 }
 
-std::optional<nlohmann::json> find_collection(const RaindropAccount& raindrop, const std::string& collection_name)
+namespace
 {
-    auto r = cpr::Get(cpr::Url{RaindropAccount::base_url + "/rest/v1/collections"},
-        cpr::Bearer{ raindrop.token },
-        cpr::Header{{ "Content-Type", "application/json" }},
-        cpr::Header{{ "Accept", "application/json" }});
-
-    if (r.status_code != 200)
+    RaindropPage fetched_page(const cpr::Response& r)
     {
-        throw std::runtime_error{ "Error trying to find collection: " + r.text };
+        if (r.status_code != 200)
+        {
+            throw std::runtime_error{ "Error fetching raindrops: " + r.text };
+        }
+
+        RaindropPage raindrop_page;
+        if (!parse_raindrop_page(r.text, raindrop_page))
+        {
+            throw std::runtime_error{ "Malformed response while fetching raindrops: " + r.text };
+        }
+
+        return raindrop_page;
     }
-    auto response = nlohmann::json::parse(r.text);
+}
 
-    return find_collection_in_response(response, collection_name);
+nlohmann::json create_raindrops(const RaindropAccount &raindropio, const nlohmann::json& request)
+{
+    return created_raindrops(raindropio.http->post(raindropio.base_url + "/rest/v1/raindrops/", raindropio.token, request.dump()));
 }
 
-std::optional<nlohmann::json> find_collection_in_response(nlohmann::json &response, const std::string &collection_name)
+std::future<nlohmann::json> create_raindrops_async(const RaindropAccount &raindropio, const nlohmann::json &request)
 {
-    auto& items = response["items"];
-    auto itr = std::find_if(items.begin(), items.end(), [&](auto&& item)
+    auto response = raindropio.http->post_async(raindropio.base_url + "/rest/v1/raindrops/", raindropio.token, request.dump());
+
+    // deferred: the response is checked by whoever waits for it, no thread is started
+    return std::async(std::launch::deferred, [response = std::move(response)]() mutable
     {
-        return collection_name == item["title"].template get<std::string>();
+        return created_raindrops(response.get());
     });
+}
+
+bool get_raindrops(const RaindropAccount &radindropio, uint64_t id, std::vector<Raindrop>& result, int page, int perpage)
+{
+    auto r = radindropio.http->get(radindropio.base_url + "/rest/v1/raindrops/" + std::to_string(id), radindropio.token,
+        cpr::Parameters{{"perpage", std::to_string(perpage)}, {"page", std::to_string(page)}});
+
+    auto raindrop_page = fetched_page(r);
+
+    auto fetched_records = static_cast<size_t>(perpage * page) + raindrop_page.items.size();
+    auto total_records = static_cast<size_t>(raindrop_page.count);
 
-    if (itr == items.end())
-        return std::nullopt;
-    else
-        return *itr;
+    result = std::move(raindrop_page.items);
+
+    return !result.empty() && fetched_records < total_records;
 }
 
-bool get_raindrops(const RaindropAccount &radindropio, uint64_t id, std::vector<nlohmann::json>& result, int page, int perpage)
+std::future<nlohmann::json> create_raindrops_async_view(const RaindropAccount &raindropio, std::string_view body)
 {
-    auto r = cpr::Get(cpr::Url{RaindropAccount::base_url + "/rest/v1/raindrops/" + std::to_string(id) + "?perpage=" + std::to_string(perpage) + "&page=" + std::to_string(page)},
-        cpr::Bearer{ radindropio.token },
-        cpr::Header{{ "Content-Type", "application/json" }},
-        cpr::Header{{ "Accept", "application/json" }});
+    auto response = send_raindrops_async_view(raindropio, body);
 
-    if (r.status_code != 200)
+    return std::async(std::launch::deferred, [response = std::move(response)]() mutable
     {
-        throw std::runtime_error{ "Error creating a raindrop: " + r.text };
-    }
+        return created_raindrops(response.get());
+    });
+}
+
+std::future<cpr::Response> send_raindrops_async_view(const RaindropAccount &raindropio, std::string_view body)
+{
+    return raindropio.http->post_async_view(raindropio.base_url + "/rest/v1/raindrops/", raindropio.token, body);
+}
 
-    auto j = nlohmann::json::parse(r.text);
-    auto items = j["items"];
-    
-    auto fetched_records = perpage * page + items.size();
-    auto total_records = j["count"].get<int>();
+std::future<RaindropPage> get_raindrops_async(const RaindropAccount &radindropio, uint64_t id, int page, int perpage)
+{
+    auto response = radindropio.http->get_async(radindropio.base_url + "/rest/v1/raindrops/" + std::to_string(id), radindropio.token,
+        QueryParameters{{"perpage", std::to_string(perpage)}, {"page", std::to_string(page)}});
 
-    items.get_to(result);
+    return std::async(std::launch::deferred, [response = std::move(response)]() mutable
+    {
+        return fetched_page(response.get());
+    });
+}
 
-    return !result.empty() && fetched_records < total_records;
+namespace
+{
+    /// @brief SAX handler that only keeps "count" and the "link" and "_id" of each element of "items"
+    class RaindropPageSax : public nlohmann::json_sax<nlohmann::json>
+    {
+    public:
+        explicit RaindropPageSax(RaindropPage& page) : page(page) {}
+
+        bool null() override { return true; }
+        bool boolean(bool) override { return true; }
+        bool number_integer(number_integer_t val) override { return number(val); }
+        bool number_unsigned(number_unsigned_t val) override { return number(val); }
+        bool number_float(number_float_t, const string_t&) override { return true; }
+        bool string(string_t& val) override
+        {
+            if (in_item() && item_key == ItemKey::link)
+            {
+                link = std::move(val);
+                has_link = true;
+            }
+            return true;
+        }
+        bool binary(binary_t&) override { return true; }
+        bool start_object(std::size_t) override
+        {
+            if (in_items && depth == items_depth)
+            {
+                has_link = false;
+                has_id = false;
+                item_key = ItemKey::other;
+            }
+            ++depth;
+            return true;
+        }
+        bool end_object() override
+        {
+            if (in_item() && has_link && has_id)
+                page.items.emplace_back(std::move(link), id);
+            --depth;
+            return true;
+        }
+        bool start_array(std::size_t) override
+        {
+            ++depth;
+            if (depth == 2 && root_key == RootKey::items)
+            {
+                in_items = true;
+                items_depth = depth;
+            }
+            return true;
+        }
+        bool end_array() override
+        {
+            if (in_items && depth == items_depth)
+                in_items = false;
+            --depth;
+            return true;
+        }
+        bool key(string_t& val) override
+        {
+            if (depth == 1)
+                root_key = val == "items" ? RootKey::items : val == "count" ? RootKey::count : RootKey::other;
+            else if (in_item())
+                item_key = val == "link" ? ItemKey::link : val == "_id" ? ItemKey::id : ItemKey::other;
+            return true;
+        }
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override { return false; }
+    private:
+        enum class RootKey { other, items, count };
+        enum class ItemKey { other, link, id };
+
+        /// @return True when the parser is right inside one of the objects in "items"
+        bool in_item() const { return in_items && depth == items_depth + 1; }
+
+        template<typename T>
+        bool number(T val)
+        {
+            if (depth == 1 && root_key == RootKey::count)
+            {
+                page.count = static_cast<int>(val);
+            }
+            else if (in_item() && item_key == ItemKey::id)
+            {
+                id = static_cast<uint64_t>(val);
+                has_id = true;
+            }
+            return true;
+        }
+
+        RaindropPage& page;
+        int depth = 0;
+        int items_depth = 0;
+        bool in_items = false;
+        RootKey root_key = RootKey::other;
+        ItemKey item_key = ItemKey::other;
+        std::string link;
+        uint64_t id = 0;
+        bool has_link = false;
+        bool has_id = false;
+    };
+}
+
+bool parse_raindrop_page(std::string_view text, RaindropPage &page)
+{
+    RaindropPageSax sax{ page };
+    return nlohmann::json::sax_parse(text.begin(), text.end(), &sax);
 }
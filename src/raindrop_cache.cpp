@@ -1,11 +1,34 @@
 #include <algorithm>
 #include <iostream>
+#include <ctime>
+#include <deque>
+#include <future>
 
-#include <ada.h>
+#include <stdlib.h>
 
 #include <raindrop_cache.h>
+#include <cache_snapshot.h>
 #include <app.h>
 
+namespace
+{
+    int64_t unix_now()
+    {
+        return static_cast<int64_t>(std::time(nullptr));
+    }
+
+    /// @brief Formats the given unix time as a raindrop search date (YYYY-MM-DD, UTC)
+    std::string search_date(int64_t time)
+    {
+        const auto t = static_cast<std::time_t>(time);
+        std::tm tm{};
+        gmtime_r(&t, &tm);
+        char buffer[16];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d", &tm);
+        return buffer;
+    }
+}
+
 RaindropCache::RaindropCache(const RaindropAccount &account)
     : RaindropCache(account, 50)
 {
@@ -16,102 +39,618 @@ RaindropCache::RaindropCache(const RaindropAccount &account, int results_per_pag
 {
 }
 
+RaindropCache::~RaindropCache()
+{
+    std::error_code ec;
+    if (!spill_dir.empty())
+        std::filesystem::remove_all(spill_dir, ec);
+}
+
 Result<RaindropCache::Entry, FindErrorCode> RaindropCache::find_by_link(const uint64_t col, const std::string &link)
 {
     if (App::VERBOSE)
         std::cout << "Searching for " << link << " in collection " << col << std::endl;
 
-    auto itr = collections.find(col);
-    if (itr == collections.end())
+    OUTCOME_TRY(auto ids, find_by_links(col, { link }));
+
+    if (!ids.front())
+        return Error{FindErrorCode::no_such_raindrop};
+
+    return Entry{ link, *ids.front() };
+}
+
+Result<std::vector<std::optional<uint64_t>>, FindErrorCode> RaindropCache::find_by_links(const uint64_t col, const std::vector<std::string> &links)
+{
+    auto [collection, lock] = lock_collection(col);
+
+    if (collection.needs_refresh)
     {
-        if (App::VERBOSE)
-            std::cout << "Creating a collection cache for collection " << col << std::endl;
+        OUTCOME_TRY(refresh(col, collection));
+    }
+
+    std::vector<std::optional<uint64_t>> ids(links.size());
+    std::vector<size_t> missing;
 
-        itr = collections.try_emplace(col).first;
+    for (size_t i = 0; i < links.size(); i++)
+    {
+        ids[i] = collection.entries.find(links[i]);
+        if (!ids[i])
+            missing.push_back(i);
     }
 
-    auto& collection = itr->second;
+    if (App::VERBOSE)
+        std::cout << "Cache hits: " << links.size() - missing.size() << " of " << links.size() << " links in collection " << col << std::endl;
 
-    // entry was already cached, great!
-    if (auto entry = std::find_if(collection.entries.begin(), collection.entries.end(), [&link](const Entry& e) { return e.first == link; });
-        entry != collection.entries.end())
+    if (!missing.empty() && collection.next_page_to_fetch >= 0)
     {
-        if (App::VERBOSE)
-            std::cout << "Cache hit!" << std::endl;
-        return *entry;
+        auto fetched = fetch_missing(col, collection, links, ids, missing);
+        collection.memory = collection.entries.memory_usage();
+        enforce_budget(col);
+        OUTCOME_TRY(fetched);
     }
 
-    // we need to fetch more entries
+    return ids;
+}
 
-    while (collection.next_page_to_fetch >= 0)
+Result<void, FindErrorCode> RaindropCache::fetch_missing(const uint64_t col, Collection &collection, const std::vector<std::string> &links,
+    std::vector<std::optional<uint64_t>> &ids, std::vector<size_t> &missing)
+{
+    // settles the links that arrived with the last fetched pages
+    auto resolve = [&]()
+    {
+        missing.erase(std::remove_if(missing.begin(), missing.end(), [&](size_t i)
+        {
+            ids[i] = collection.entries.find(links[i]);
+            return ids[i].has_value();
+        }), missing.end());
+    };
+
+    while (!missing.empty() && collection.next_page_to_fetch >= 0)
     {
+        if (prefers_lookup(collection, missing.size()))
+        {
+            return lookup_missing(col, collection, links, ids, missing);
+        }
+
         if (App::VERBOSE)
             std::cout << "Fetching entries from raindrop (continuing at page " << collection.next_page_to_fetch << ")" << std::endl;
 
+        // changes made while we are paging will be picked by the next refresh
+        if (collection.next_page_to_fetch == 0)
+            collection.synced_at = unix_now();
+
         OUTCOME_TRY(auto more_entries, fetch_next_entries(col, collection.next_page_to_fetch));
+        collection.next_page_to_fetch = more_entries.next_page;
+        collection.count = more_entries.count;
 
         // update the cache with fresh entries
-        std::copy(more_entries.begin(), more_entries.end(), std::back_inserter(collection.entries));
+        merge(collection, more_entries.results, false);
+        resolve();
 
-        // search the entry only in the current page
-        if (auto entry = std::find_if(more_entries.begin(), more_entries.end(), [&link](const Entry& e) { return e.first == link; });
-            entry != more_entries.end())
+        // now that the collection size is known, every remaining page can be requested at once
+        if (prefetch_limit > 0 && !missing.empty() && collection.next_page_to_fetch >= 0 && !prefers_lookup(collection, missing.size()))
         {
-            return *entry;
+            OUTCOME_TRY(prefetch(col, collection, more_entries.count));
+            resolve();
         }
     }
 
-    return Error{FindErrorCode::no_such_raindrop};
+    return outcome::success();
 }
 
-Result<std::vector<RaindropCache::Entry>, FindErrorCode> RaindropCache::fetch_next_entries(const uint64_t col, int& next_page) const
+Result<std::vector<std::optional<uint64_t>>, FindErrorCode> RaindropCache::reconcile(const uint64_t col, const std::vector<std::string> &links)
 {
-    auto url = ada::parse<ada::url>(RaindropAccount::base_url);
-    
-    if (!url)
+    auto [collection, lock] = lock_collection(col);
+
+    std::vector<std::optional<uint64_t>> ids(links.size());
+    std::vector<size_t> missing;
+
+    for (size_t i = 0; i < links.size(); i++)
     {
-        return Error{FindErrorCode::invalid_url, "Could not parse " + RaindropAccount::base_url};
+        ids[i] = collection.entries.find(links[i]);
+        if (!ids[i])
+            missing.push_back(i);
     }
-    
-    if (auto pathname = std::filesystem::path{ url->get_pathname() }.append("/rest/v1/raindrops/").append(std::to_string(col)).string(); !url->set_pathname(pathname))
+
+    // a fully fetched collection would claim the links don't exist, so raindrop is always asked
+    if (!missing.empty())
     {
-        return Error{FindErrorCode::invalid_url, "Could not parse path '" + pathname + "'"};
+        auto looked_up = lookup_missing(col, collection, links, ids, missing);
+        collection.memory = collection.entries.memory_usage();
+        enforce_budget(col);
+        OUTCOME_TRY(looked_up);
     }
 
-    auto res = cpr::Get(cpr::Url{url->get_href()},
-        cpr::Parameters{{"perpage", std::to_string(per_page)}, {"page", std::to_string(next_page)}},
-        cpr::Bearer{ account.token },
-        cpr::Header{{ "Content-Type", "application/json" }},
-        cpr::Header{{ "Accept", "application/json" }}
-    );
+    return ids;
+}
 
-    if (res.status_code != 200)
-        return Error{FindErrorCode::fetch_error, "Error while searching for a raindrop: " + res.text };
+void RaindropCache::insert(const uint64_t col, const std::string &link, uint64_t id)
+{
+    auto [collection, lock] = lock_collection(col);
 
-    auto body = nlohmann::json::parse(res.text);
-    auto items = body["items"];
+    // newest_id is left alone: it marks how far the collection was synced, and raindrops
+    // created by others since then are older than the ones we just created. Snapshots keep
+    // it in their header for the same reason, instead of taking the highest id they hold
+    collection.entries.insert(link, id);
+    collection.memory = collection.entries.memory_usage();
+}
+
+bool RaindropCache::prefers_lookup(const Collection &collection, size_t missing) const
+{
+    // the first page is always fetched: it is needed to know how big the collection is
+    if (lookup_strategy != LookupStrategy::adaptive || collection.count < 0)
+        return false;
+
+    const auto remaining_records = std::max(collection.count - collection.next_page_to_fetch * per_page, 0);
+    const auto remaining_pages = static_cast<size_t>((remaining_records + per_page - 1) / per_page);
+    // worst case: one request per batch plus one per link that turns out to exist somewhere
+    const auto lookup_requests = (missing + lookup_batch_size - 1) / lookup_batch_size + missing;
+
+    return lookup_requests < remaining_pages;
+}
 
-    std::vector<RaindropCache::Entry> entries;
+Result<void, FindErrorCode> RaindropCache::lookup_missing(const uint64_t col, Collection &collection, const std::vector<std::string> &links,
+    std::vector<std::optional<uint64_t>> &ids, std::vector<size_t> &missing)
+{
+    if (App::VERBOSE)
+        std::cout << "Looking up " << missing.size() << " links directly instead of paging collection " << col << std::endl;
 
-    std::transform(items.begin(), items.end(), std::back_inserter(entries), [](const nlohmann::json& rd)
+    for (size_t begin = 0; begin < missing.size(); begin += lookup_batch_size)
     {
-        const auto link = rd["link"].get<std::string>();
-        const auto id = rd["_id"].get<uint64_t>();
-        
-        return std::make_pair(link, id);
+        const auto end = std::min(begin + lookup_batch_size, missing.size());
+
+        std::vector<std::string> batch;
+        for (auto i = begin; i < end; i++)
+            batch.push_back(links[missing[i]]);
+
+        // the ids may belong to any collection, so each one must be checked
+        OUTCOME_TRY(auto existing_ids, fetch_existing_ids(batch));
+        for (const auto id : existing_ids)
+        {
+            OUTCOME_TRY(auto raindrop, fetch_raindrop(id));
+            // not merged: a single raindrop says nothing about how far the collection is synced
+            if (raindrop.second == col)
+                collection.entries.insert(raindrop.first.first, raindrop.first.second);
+        }
+
+        for (auto i = begin; i < end; i++)
+            ids[missing[i]] = collection.entries.find(links[missing[i]]);
+    }
+
+    // every link is settled, whatever was not found does not exist in the collection
+    missing.clear();
+    return outcome::success();
+}
+
+void RaindropCache::save_snapshots() const
+{
+    if (snapshot_dir.empty())
+        return;
+
+    for (const auto& [col, collection] : collections)
+    {
+        // a partial cache says nothing about the raindrops that were not fetched yet.
+        // Evicted collections were already written when they were evicted
+        if (collection.next_page_to_fetch >= 0 || collection.needs_refresh || collection.evicted)
+            continue;
+
+        const auto ok = write_snapshot(snapshot_file(col), col, collection.synced_at, collection.newest_id, collection.entries.size(),
+            [&entries = collection.entries](const SnapshotVisitor& visit)
+            {
+                entries.for_each(visit);
+            });
+
+        if (!ok)
+            std::cerr << "[WARNING] Could not write the cache snapshot of collection " << col << " to " << snapshot_file(col) << std::endl;
+        else if (App::VERBOSE)
+            std::cout << "Saved " << collection.entries.size() << " entries of collection " << col << " to " << snapshot_file(col) << std::endl;
+    }
+}
+
+std::pair<RaindropCache::Collection&, std::unique_lock<std::mutex>> RaindropCache::lock_collection(const uint64_t col)
+{
+    Collection* collection = nullptr;
+    {
+        std::lock_guard lock{ collections_mutex };
+        collection = &collections.try_emplace(col).first->second;
+        collection->last_used = ++use_clock;
+    }
+
+    std::unique_lock lock{ collection->mutex };
+
+    if (!collection->loaded)
+    {
+        restore(col, *collection);
+        collection->loaded = true;
+        collection->memory = collection->entries.memory_usage();
+        enforce_budget(col);
+    }
+    else if (collection->evicted)
+    {
+        reload(col, *collection);
+        collection->memory = collection->entries.memory_usage();
+        enforce_budget(col);
+    }
+
+    return { *collection, std::move(lock) };
+}
+
+void RaindropCache::restore(const uint64_t col, Collection &collection)
+{
+    if (App::VERBOSE)
+        std::cout << "Creating a collection cache for collection " << col << std::endl;
+
+    if (snapshot_dir.empty())
+        return;
+
+    // the watermark comes from the header: the entries include the raindrops we created
+    const auto restored = read_snapshot(snapshot_file(col), col, collection.synced_at, collection.newest_id, [&collection](std::string_view link, uint64_t id)
+    {
+        collection.entries.insert(link, id);
     });
 
-    auto fetched_records = per_page * next_page + items.size();
-    auto total_records = body["count"].get<int>();
+    if (restored)
+    {
+        if (App::VERBOSE)
+            std::cout << "Restored " << collection.entries.size() << " entries of collection " << col << " from " << snapshot_file(col) << std::endl;
+
+        collection.next_page_to_fetch = -1;
+        collection.needs_refresh = true;
+    }
+    else
+    {
+        reset(collection);
+    }
+}
+
+void RaindropCache::reset(Collection &collection)
+{
+    collection.next_page_to_fetch = 0;
+    collection.entries = LinkStore{};
+    collection.synced_at = 0;
+    collection.needs_refresh = false;
+    collection.newest_id = 0;
+    collection.count = -1;
+}
+
+void RaindropCache::enforce_budget(const uint64_t in_use)
+{
+    if (memory_budget == 0)
+        return;
+
+    std::lock_guard lock{ collections_mutex };
+
+    size_t usage = 0;
+    for (const auto& [col, collection] : collections)
+        usage += collection.memory;
+
+    // collections used by other threads are skipped instead of waited for
+    std::vector<uint64_t> busy;
+
+    while (usage > memory_budget)
+    {
+        // the collection being used is never evicted, even when it alone exceeds the budget
+        auto victim = collections.end();
+        for (auto itr = collections.begin(); itr != collections.end(); ++itr)
+        {
+            if (itr->first != in_use && itr->second.memory > 0
+                && std::find(busy.begin(), busy.end(), itr->first) == busy.end()
+                && (victim == collections.end() || itr->second.last_used < victim->second.last_used))
+            {
+                victim = itr;
+            }
+        }
+
+        if (victim == collections.end())
+            return;
+
+        std::unique_lock victim_lock{ victim->second.mutex, std::try_to_lock };
+        if (!victim_lock.owns_lock())
+        {
+            busy.push_back(victim->first);
+            continue;
+        }
 
-    if(!entries.empty() && fetched_records < total_records)
+        const size_t freed = victim->second.memory;
+        if (!evict(victim->first, victim->second))
+            return;
+        usage -= freed;
+    }
+}
+
+bool RaindropCache::evict(const uint64_t col, Collection &collection)
+{
+    // created with a unique name and private permissions, since it is removed with all its
+    // content in the end. A predictable name could be taken or linked elsewhere by another user
+    if (spill_dir.empty() && (collection.next_page_to_fetch >= 0 || snapshot_dir.empty()))
     {
-        next_page = next_page + 1;
-        return entries;
+        std::error_code ec;
+        auto pattern = (std::filesystem::temp_directory_path(ec) / "folderdrop-XXXXXX").string();
+        if (ec || ::mkdtemp(pattern.data()) == nullptr)
+        {
+            std::cerr << "[WARNING] Could not create a directory to evict the cache of collection " << col << " to" << std::endl;
+            return false;
+        }
+        spill_dir = pattern;
+    }
+
+    // collections with every page fetched go straight to their snapshot. Partial ones would
+    // pass as complete there, so they only go to the spill directory of this run
+    const auto file = collection.next_page_to_fetch < 0 && !snapshot_dir.empty()
+        ? snapshot_file(col)
+        : spill_dir / (std::to_string(col) + ".fdc");
+
+    const auto ok = write_snapshot(file, col, collection.synced_at, collection.newest_id, collection.entries.size(),
+        [&entries = collection.entries](const SnapshotVisitor& visit)
+        {
+            entries.for_each(visit);
+        });
+
+    if (!ok)
+    {
+        std::cerr << "[WARNING] Could not evict the cache of collection " << col << " to " << file << std::endl;
+        return false;
+    }
+
+    if (App::VERBOSE)
+        std::cout << "Evicted " << collection.entries.size() << " entries of collection " << col << " to " << file << std::endl;
+
+    // clear keeps the capacity, so really release the memory
+    collection.entries = LinkStore{};
+    collection.memory = 0;
+    collection.evicted = true;
+    collection.spill_file = file;
+    return true;
+}
+
+void RaindropCache::reload(const uint64_t col, Collection &collection)
+{
+    int64_t synced_at = 0;
+    uint64_t newest_id = 0;
+    const auto restored = read_snapshot(collection.spill_file, col, synced_at, newest_id, [&entries = collection.entries](std::string_view link, uint64_t id)
+    {
+        entries.insert(link, id);
+    });
+
+    if (App::VERBOSE)
+        std::cout << "Reloaded " << collection.entries.size() << " entries of collection " << col << " from " << collection.spill_file << std::endl;
+
+    if (!restored)
+    {
+        std::cerr << "[WARNING] Could not reload the cache of collection " << col << " from " << collection.spill_file << ", starting over" << std::endl;
+        reset(collection);
+    }
+
+    collection.evicted = false;
+}
+
+Result<void, FindErrorCode> RaindropCache::refresh(const uint64_t col, Collection &collection)
+{
+    const auto started_at = unix_now();
+    int count = -1;
+
+    if (sync_mode == SyncMode::delta)
+    {
+        OUTCOME_TRY(refresh_delta(col, collection, count));
     }
     else
     {
-        next_page = -1;
-        return entries;
+        OUTCOME_TRY(refresh_changes(col, collection, count));
+    }
+
+    // removed raindrops never show up as changes. When the collection shrank
+    // the snapshot can't be trusted anymore, so start over from the first page
+    if (collection.entries.size() > static_cast<size_t>(count))
+    {
+        if (App::VERBOSE)
+            std::cout << "Collection " << col << " has less raindrops than its snapshot, discarding it" << std::endl;
+
+        collection.entries.clear();
+        collection.newest_id = 0;
+        collection.next_page_to_fetch = 0;
+    }
+    else
+    {
+        collection.synced_at = started_at;
+    }
+
+    collection.needs_refresh = false;
+    return outcome::success();
+}
+
+Result<void, FindErrorCode> RaindropCache::refresh_changes(const uint64_t col, Collection &collection, int &count)
+{
+    // search dates are days in UTC, so go back one more day to never miss a change
+    const auto search = "lastUpdate:>" + search_date(collection.synced_at - 24 * 60 * 60);
+
+    if (App::VERBOSE)
+        std::cout << "Refreshing collection " << col << " with raindrops matching '" << search << "'" << std::endl;
+
+    int next_page = 0;
+    while (next_page >= 0)
+    {
+        OUTCOME_TRY(auto changed_entries, fetch_next_entries(col, next_page, search));
+        next_page = changed_entries.next_page;
+
+        merge(collection, changed_entries.results, true);
+    }
+
+    OUTCOME_TRY(count, fetch_collection_count(col));
+    return outcome::success();
+}
+
+Result<void, FindErrorCode> RaindropCache::refresh_delta(const uint64_t col, Collection &collection, int &count)
+{
+    const auto known_newest_id = collection.newest_id;
+
+    if (App::VERBOSE)
+        std::cout << "Refreshing collection " << col << " with raindrops newer than " << known_newest_id << std::endl;
+
+    int next_page = 0;
+    while (next_page >= 0)
+    {
+        // without a search, count is the size of the whole collection
+        OUTCOME_TRY(auto newest_entries, fetch_next_entries(col, next_page, {}, "-created"));
+        next_page = newest_entries.next_page;
+        count = newest_entries.count;
+        collection.count = count;
+
+        auto& results = newest_entries.results;
+        auto known = std::find_if(results.begin(), results.end(), [known_newest_id](const Entry& e) { return e.second <= known_newest_id; });
+        if (known != results.end())
+        {
+            results.erase(known, results.end());
+            next_page = -1;
+        }
+
+        merge(collection, results, true);
+    }
+
+    return outcome::success();
+}
+
+void RaindropCache::merge(Collection &collection, const std::vector<Entry> &entries, bool overwrite)
+{
+    for (const auto& [link, id] : entries)
+    {
+        if (overwrite)
+            collection.entries.insert_or_assign(link, id);
+        else
+            collection.entries.insert(link, id);
+
+        collection.newest_id = std::max(collection.newest_id, id);
+    }
+}
+
+Result<void, FindErrorCode> RaindropCache::prefetch(const uint64_t col, Collection &collection, int count)
+{
+    const auto url = page_url(col);
+
+    const int last_page = (count + per_page - 1) / per_page - 1;
+    int next_page = collection.next_page_to_fetch;
+
+    if (App::VERBOSE)
+        std::cout << "Prefetching pages " << next_page << " to " << last_page << " of collection " << col
+            << " (" << prefetch_limit << " at a time)" << std::endl;
+
+    // every request runs on the http engine, so no thread is needed per page
+    std::deque<std::pair<int, std::future<cpr::Response>>> in_flight;
+    std::optional<std::pair<int, Error<FindErrorCode>>> failure;
+
+    while (!in_flight.empty() || (next_page <= last_page && !failure))
+    {
+        while (static_cast<int>(in_flight.size()) < prefetch_limit && next_page <= last_page && !failure)
+        {
+            in_flight.emplace_back(next_page, account.http->get_async(url, account.token, page_parameters(next_page)));
+            next_page++;
+        }
+
+        auto [page, future] = std::move(in_flight.front());
+        in_flight.pop_front();
+
+        auto result = parse_page(future.get(), page);
+        if (result.has_error())
+        {
+            if (!failure || page < failure->first)
+                failure.emplace(page, result.error());
+            continue;
+        }
+
+        merge(collection, result.value().results, false);
+    }
+
+    if (failure)
+    {
+        // pages after the failed one may have been merged already, they will just be fetched again
+        collection.next_page_to_fetch = failure->first;
+        return failure->second;
     }
+
+    collection.next_page_to_fetch = -1;
+    return outcome::success();
+}
+
+std::filesystem::path RaindropCache::snapshot_file(const uint64_t col) const
+{
+    return snapshot_dir / (std::to_string(col) + ".fdc");
+}
+
+Result<FetchResult<RaindropCache::Entry>, FindErrorCode> RaindropCache::fetch_next_entries(const uint64_t col, int page, const std::string& search, const std::string& sort) const
+{
+    return parse_page(account.http->get_async(page_url(col), account.token, page_parameters(page, search, sort)).get(), page);
+}
+
+std::string RaindropCache::page_url(const uint64_t col) const
+{
+    return account.base_url + "/rest/v1/raindrops/" + std::to_string(col);
+}
+
+QueryParameters RaindropCache::page_parameters(int page, const std::string &search, const std::string &sort) const
+{
+    QueryParameters parameters{{"perpage", std::to_string(per_page)}, {"page", std::to_string(page)}};
+    if (!search.empty())
+        parameters.emplace_back("search", search);
+    if (!sort.empty())
+        parameters.emplace_back("sort", sort);
+    return parameters;
+}
+
+Result<FetchResult<RaindropCache::Entry>, FindErrorCode> RaindropCache::parse_page(const cpr::Response &res, int page) const
+{
+    if (res.status_code != 200)
+        return Error{FindErrorCode::fetch_error, "Error while searching for a raindrop: " + res.text };
+
+    RaindropPage raindrop_page;
+    if (!parse_raindrop_page(res.text, raindrop_page))
+        return Error{FindErrorCode::fetch_error, "Malformed response while searching for a raindrop: " + res.text };
+
+    auto& entries = raindrop_page.items;
+    auto fetched_records = static_cast<size_t>(per_page * page) + entries.size();
+    auto total_records = raindrop_page.count;
+
+    const auto next_page = !entries.empty() && fetched_records < static_cast<size_t>(total_records) ? page + 1 : -1;
+    return FetchResult<Entry>{ next_page, per_page, std::move(entries), total_records };
+}
+
+Result<int, FindErrorCode> RaindropCache::fetch_collection_count(const uint64_t col) const
+{
+    auto res = account.http->get(account.base_url + "/rest/v1/collection/" + std::to_string(col), account.token);
+
+    if (res.status_code != 200)
+        return Error{FindErrorCode::fetch_error, "Error while fetching collection " + std::to_string(col) + ": " + res.text };
+
+    auto body = nlohmann::json::parse(res.text);
+    return body["item"]["count"].get<int>();
+}
+
+Result<std::vector<uint64_t>, FindErrorCode> RaindropCache::fetch_existing_ids(const std::vector<std::string> &links) const
+{
+    const nlohmann::json request = { { "urls", links } };
+
+    auto res = account.http->post(account.base_url + "/rest/v1/import/url/exists", account.token, request.dump());
+
+    if (res.status_code != 200)
+        return Error{FindErrorCode::fetch_error, "Error while checking if links exist: " + res.text };
+
+    auto body = nlohmann::json::parse(res.text);
+    if (!body.value("result", false) || !body.contains("ids"))
+        return std::vector<uint64_t>{};
+
+    return body["ids"].get<std::vector<uint64_t>>();
+}
+
+Result<std::pair<RaindropCache::Entry, uint64_t>, FindErrorCode> RaindropCache::fetch_raindrop(const uint64_t id) const
+{
+    auto res = account.http->get(account.base_url + "/rest/v1/raindrop/" + std::to_string(id), account.token);
+
+    if (res.status_code != 200)
+        return Error{FindErrorCode::fetch_error, "Error while fetching raindrop " + std::to_string(id) + ": " + res.text };
+
+    auto body = nlohmann::json::parse(res.text);
+    const auto& item = body["item"];
+    const auto collection = item.contains("collection")
+        ? item["collection"]["$id"].get<int64_t>()
+        : item.value("collectionId", int64_t{ -1 });
+
+    return std::make_pair(Entry{ item["link"].get<std::string>(), item["_id"].get<uint64_t>() }, static_cast<uint64_t>(collection));
 }
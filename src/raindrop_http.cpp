@@ -0,0 +1,403 @@
+#include <raindrop_http.h>
+
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <thread>
+
+#include <zlib.h>
+
+namespace
+{
+    /// @brief Reads a non negative integer header
+    std::optional<long long> integer_header(const cpr::Response& response, const char* name)
+    {
+        auto itr = response.header.find(name);
+        if (itr == response.header.end())
+            return std::nullopt;
+
+        long long value = 0;
+        const auto& text = itr->second;
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc{} || value < 0)
+            return std::nullopt;
+        return value;
+    }
+
+    /// @brief Compresses a request body in the gzip format
+    /// @return The compressed body, or nullopt when zlib fails
+    std::optional<std::string> gzip(const std::string& body)
+    {
+        z_stream stream{};
+        // 15 + 16: largest window, with a gzip header instead of a zlib one
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return std::nullopt;
+
+        std::string compressed(deflateBound(&stream, static_cast<uLong>(body.size())), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+        stream.avail_in = static_cast<uInt>(body.size());
+        stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+        stream.avail_out = static_cast<uInt>(compressed.size());
+
+        const auto status = deflate(&stream, Z_FINISH);
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        if (status != Z_STREAM_END)
+            return std::nullopt;
+        return compressed;
+    }
+
+    std::optional<long long> integer_header(const cpr::Response& response, const char* name, const char* alternative)
+    {
+        if (auto value = integer_header(response, name))
+            return value;
+        return integer_header(response, alternative);
+    }
+}
+
+void RateLimiter::acquire()
+{
+    while (auto wake_up = try_acquire())
+        std::this_thread::sleep_until(*wake_up);
+}
+
+std::optional<RateLimiter::Clock::time_point> RateLimiter::try_acquire()
+{
+    std::lock_guard lock{ mutex };
+    const auto now = Clock::now();
+    refill(now);
+
+    if (now >= blocked_until && tokens >= 1)
+    {
+        tokens -= 1;
+        return std::nullopt;
+    }
+
+    const auto until_token = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+        (1 - tokens) * std::chrono::duration<double>(window).count() / limit));
+    return std::max(blocked_until, now + until_token);
+}
+
+void RateLimiter::observe(const cpr::Response &response)
+{
+    const auto now = Clock::now();
+    std::lock_guard lock{ mutex };
+    refill(now);
+
+    if (auto new_limit = integer_header(response, "X-RateLimit-Limit", "RateLimit-Limit"); new_limit && *new_limit > 0)
+        limit = static_cast<int>(*new_limit);
+
+    // the server knows about requests made by other clients of the account too
+    if (auto remaining = integer_header(response, "X-RateLimit-Remaining", "RateLimit-Remaining"))
+    {
+        tokens = std::min(tokens, static_cast<double>(*remaining));
+
+        auto reset = integer_header(response, "X-RateLimit-Reset", "RateLimit-Reset");
+        if (*remaining == 0 && reset)
+        {
+            // reset is an epoch timestamp, translate it to the steady clock
+            const auto seconds_left = std::max<long long>(*reset - static_cast<long long>(std::time(nullptr)), 1);
+            blocked_until = std::max(blocked_until, now + std::chrono::seconds(seconds_left));
+        }
+    }
+
+    if (response.status_code == 429)
+    {
+        const auto retry_after = integer_header(response, "Retry-After").value_or(1);
+        blocked_until = std::max(blocked_until, now + std::chrono::seconds(std::max<long long>(retry_after, 1)));
+        tokens = 0;
+    }
+}
+
+void RateLimiter::refill(Clock::time_point now)
+{
+    const auto elapsed = std::chrono::duration<double>(now - last_refill).count();
+    tokens = std::min<double>(limit, tokens + elapsed * limit / std::chrono::duration<double>(window).count());
+    last_refill = now;
+}
+
+std::chrono::milliseconds backoff_delay(int attempt)
+{
+    constexpr long long base_ms = 500;
+    constexpr long long cap_ms = 30'000;
+    thread_local std::mt19937 random{ std::random_device{}() };
+
+    const auto ceiling = std::min(cap_ms, base_ms << std::min(attempt, 16));
+    // the jitter keeps clients that failed together from retrying together
+    std::uniform_int_distribution<long long> jitter{ ceiling / 2, ceiling };
+    return std::chrono::milliseconds{ jitter(random) };
+}
+
+bool is_transient_failure(const cpr::Response &response)
+{
+    return response.status_code == 0 || response.status_code >= 500;
+}
+
+RaindropHttp::RaindropHttp()
+    : share(curl_share_init())
+{
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &RaindropHttp::lock_share);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &RaindropHttp::unlock_share);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    // the connection cache is not shared: libcurl does not support using it from sessions that
+    // run at the same time on different threads, so every session keeps its own connections and
+    // the engine keeps those of its multi handle
+}
+
+RaindropHttp::~RaindropHttp()
+{
+    // sessions and the engine must let go of the share before it can be cleaned up
+    engine.reset();
+    idle_sessions.clear();
+    curl_share_cleanup(share);
+}
+
+template<typename Perform>
+cpr::Response RaindropHttp::send(Perform &&perform, bool idempotent)
+{
+    int rate_limited = 0;
+    int failed = 0;
+
+    while (true)
+    {
+        limiter.acquire();
+        auto response = perform();
+        limiter.observe(response);
+
+        auto delay = retry_delay(response, idempotent, rate_limited, failed);
+        if (!delay)
+            return response;
+
+        std::this_thread::sleep_for(*delay);
+    }
+}
+
+std::optional<std::chrono::milliseconds> RaindropHttp::retry_delay(const cpr::Response &response, bool idempotent, int &rate_limited, int &failed) const
+{
+    // a rejected request was not processed, so even a POST can be sent again. The limiter knows how long to wait
+    if (response.status_code == 429 && rate_limited++ < max_rate_limited_retries)
+    {
+        std::cerr << "[WARNING] Rate limited by raindrop, retrying " << response.url.str() << std::endl;
+        return std::chrono::milliseconds{ 0 };
+    }
+
+    if (idempotent && is_transient_failure(response) && failed < max_transient_retries)
+    {
+        const auto delay = backoff_delay(failed++);
+        std::cerr << "[WARNING] Request to " << response.url.str() << " failed (" << response.status_code << " " << response.error.message
+            << "), retrying in " << delay.count() << "ms" << std::endl;
+        return delay;
+    }
+
+    return std::nullopt;
+}
+
+bool RaindropHttp::compress(std::string &body) const
+{
+    if (!compress_requests || body.size() < min_compressed_body)
+        return false;
+
+    auto compressed = gzip(body);
+    if (!compressed)
+        return false;
+
+    body = std::move(*compressed);
+    return true;
+}
+
+std::future<cpr::Response> RaindropHttp::get_async(const std::string &url, const std::string &token, QueryParameters parameters)
+{
+    auto call = std::make_shared<AsyncCall>();
+    call->request.url = url;
+    call->request.parameters = std::move(parameters);
+    call->idempotent = true;
+    call->body_size = 0;
+    return start(std::move(call), token, false);
+}
+
+std::future<cpr::Response> RaindropHttp::post_async(const std::string &url, const std::string &token, std::string body)
+{
+    auto call = std::make_shared<AsyncCall>();
+    call->request.method = HttpRequest::Method::post;
+    call->request.url = url;
+    call->idempotent = false;
+    call->body_size = body.size();
+
+    const bool gzip_body = compress(body);
+    // the call lives until the last retry, so the request can point into it
+    call->owned_body = std::move(body);
+    call->request.body = call->owned_body;
+    return start(std::move(call), token, gzip_body);
+}
+
+std::future<cpr::Response> RaindropHttp::post_async_view(const std::string &url, const std::string &token, std::string_view body)
+{
+    if (compress_requests && body.size() >= min_compressed_body)
+        return post_async(url, token, std::string{ body });
+
+    auto call = std::make_shared<AsyncCall>();
+    call->request.method = HttpRequest::Method::post;
+    call->request.url = url;
+    call->request.body = body;
+    call->idempotent = false;
+    call->body_size = body.size();
+    return start(std::move(call), token, false);
+}
+
+std::future<cpr::Response> RaindropHttp::start(std::shared_ptr<AsyncCall> call, const std::string &token, bool gzip_body)
+{
+    call->request.headers = {
+        "Authorization: Bearer " + token,
+        "Content-Type: application/json",
+        "Accept: application/json"
+    };
+    if (gzip_body)
+        call->request.headers.emplace_back("Content-Encoding: gzip");
+
+    auto future = call->promise.get_future();
+    dispatch(get_engine(), std::move(call));
+    return future;
+}
+
+void RaindropHttp::dispatch(HttpEngine& engine, std::shared_ptr<AsyncCall> call)
+{
+    // the engine thread must never sleep, so waiting for the rate limit becomes a timer
+    if (auto wake_up = limiter.try_acquire())
+    {
+        engine.schedule(*wake_up, [this, &engine, call]() { dispatch(engine, call); });
+        return;
+    }
+
+    engine.perform(call->request, [this, &engine, call](cpr::Response response)
+    {
+        limiter.observe(response);
+        record(response, call->body_size, call->request.body.size());
+
+        if (auto delay = retry_delay(response, call->idempotent, call->rate_limited, call->failed))
+        {
+            engine.schedule(HttpEngine::Clock::now() + *delay, [this, &engine, call]() { dispatch(engine, call); });
+            return;
+        }
+
+        call->promise.set_value(std::move(response));
+    });
+}
+
+std::future<void> RaindropHttp::delay_async(std::chrono::milliseconds delay)
+{
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
+    get_engine().schedule(HttpEngine::Clock::now() + delay, [promise]() { promise->set_value(); });
+    return future;
+}
+
+HttpEngine &RaindropHttp::get_engine()
+{
+    std::lock_guard lock{ engine_mutex };
+    if (!engine)
+        engine = std::make_unique<HttpEngine>(share);
+    return *engine;
+}
+
+cpr::Response RaindropHttp::get(const std::string &url, const std::string &token, const cpr::Parameters &parameters)
+{
+    return send([&]()
+    {
+        Lease session{ *this };
+        prepare(*session, url, token, parameters);
+        session->SetBody(cpr::Body{});
+        auto response = session->Get();
+        record(response, 0, 0);
+        return response;
+    }, true);
+}
+
+cpr::Response RaindropHttp::post(const std::string &url, const std::string &token, std::string body)
+{
+    const auto body_size = body.size();
+    const bool gzip_body = compress(body);
+
+    return send([&]()
+    {
+        Lease session{ *this };
+        prepare(*session, url, token, {}, gzip_body);
+        session->SetBody(cpr::Body{ body });
+        auto response = session->Post();
+        record(response, body_size, body.size());
+        return response;
+    }, false);
+}
+
+TransferStats RaindropHttp::transfer_stats() const
+{
+    return TransferStats{ received, received_decoded, sent, sent_uncompressed };
+}
+
+std::unique_ptr<cpr::Session> RaindropHttp::acquire()
+{
+    {
+        std::lock_guard lock{ pool_mutex };
+        if (!idle_sessions.empty())
+        {
+            auto session = std::move(idle_sessions.back());
+            idle_sessions.pop_back();
+            return session;
+        }
+    }
+
+    auto session = std::make_unique<cpr::Session>();
+    auto handle = session->GetCurlHolder()->handle;
+    curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    // an empty string offers every encoding curl was built with
+    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+    return session;
+}
+
+void RaindropHttp::release(std::unique_ptr<cpr::Session> session)
+{
+    std::lock_guard lock{ pool_mutex };
+    idle_sessions.push_back(std::move(session));
+}
+
+void RaindropHttp::prepare(cpr::Session &session, const std::string &url, const std::string &token, const cpr::Parameters &parameters, bool gzip_body)
+{
+    // sessions are reused, so every option a request may set is set again
+    session.SetUrl(cpr::Url{ url });
+    session.SetParameters(parameters);
+    session.SetBearer(cpr::Bearer{ token });
+
+    cpr::Header header{
+        { "Content-Type", "application/json" },
+        { "Accept", "application/json" }
+    };
+    if (gzip_body)
+        header.emplace("Content-Encoding", "gzip");
+    session.SetHeader(header);
+}
+
+void RaindropHttp::record(const cpr::Response &response, size_t body_size, size_t sent_body_size)
+{
+    // downloaded_bytes counts the body as it came, before curl decoded it
+    received += static_cast<uint64_t>(std::max<cpr::cpr_off_t>(response.downloaded_bytes, 0));
+    received_decoded += response.text.size();
+    sent += sent_body_size;
+    sent_uncompressed += body_size;
+}
+
+void RaindropHttp::lock_share(CURL*, curl_lock_data data, curl_lock_access, void *user)
+{
+    static_cast<RaindropHttp*>(user)->share_locks[data].lock();
+}
+
+void RaindropHttp::unlock_share(CURL*, curl_lock_data data, void *user)
+{
+    static_cast<RaindropHttp*>(user)->share_locks[data].unlock();
+}
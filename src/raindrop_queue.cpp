@@ -1,19 +1,78 @@
 #include <raindrop_queue.h>
 
+#include <chrono>
 #include <iostream>
+#include <ostream>
+#include <streambuf>
 
 #include <app.h>
 
-RaindropQueue::RaindropQueue(const RaindropAccount& account, uint64_t collection_id, std::vector<std::string> tags)
+namespace
+{
+    /// @brief Stream buffer that appends what is written to a string
+    class StringAppender : public std::streambuf
+    {
+    public:
+        explicit StringAppender(std::string& target) : target(target) {}
+    protected:
+        int_type overflow(int_type c) override
+        {
+            if (!traits_type::eq_int_type(c, traits_type::eof()))
+                target.push_back(traits_type::to_char_type(c));
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char* data, std::streamsize count) override
+        {
+            target.append(data, static_cast<size_t>(count));
+            return count;
+        }
+    private:
+        std::string& target;
+    };
+
+    /// @brief Serializes a batch into the buffer, reusing its memory
+    void serialize(const nlohmann::json& batch, std::string& buffer)
+    {
+        buffer.clear();
+        // json::dump returns a new string every time, a stream can append to ours
+        StringAppender appender{ buffer };
+        std::ostream stream{ &appender };
+        stream << batch;
+    }
+
+    template<typename T>
+    bool is_ready(const std::future<T>& future)
+    {
+        return future.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready;
+    }
+}
+
+RaindropQueue::RaindropQueue(const RaindropAccount& account, uint64_t collection_id, std::vector<std::string> tags, int max_in_flight)
     : account(account),
     collection_id(collection_id),
-    tags(std::move(tags))
+    tags(std::move(tags)),
+    max_in_flight(max_in_flight)
 {
 }
 
 RaindropQueue::~RaindropQueue()
 {
-    offload();
+    try
+    {
+        offload();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "[ERROR] Could not upload the last raindrops: " << e.what() << std::endl;
+    }
+
+    // requests still in flight point to the bodies of their uploads
+    for (auto& upload : uploads)
+    {
+        if (upload.response.valid())
+            upload.response.wait();
+    }
 }
 
 std::optional<nlohmann::json> RaindropQueue::append(RaindropBuilder rd)
@@ -38,46 +97,232 @@ std::optional<nlohmann::json> RaindropQueue::append(RaindropBuilder rd)
 
     if (items.size() >= max_queue_size)
     {
-        return offload();
+        if (max_in_flight <= 0)
+            return offload();
+
+        submit();
     }
 
+    if (max_in_flight > 0)
+        return collect(false);
+
     return {};
 }
 
 std::optional<nlohmann::json> RaindropQueue::offload()
 {
+    if (max_in_flight > 0)
+    {
+        if (payload.contains("items") && !payload["items"].empty())
+            submit();
+
+        return collect(true);
+    }
+
     if (payload.contains("items") && !payload["items"].empty())
     {
-        if (App::VERBOSE)
+        // a batch that failed is not left behind to be sent again
+        Upload upload{ std::move(payload), take_buffer() };
+        init_payload();
+
+        advance(upload, true);
+        spare_buffers.push_back(std::move(upload.body));
+
+        auto& response = *upload.result;
+        if (observer)
+            observer(response);
+
+        return std::move(response);
+    }
+    else
+    {
+        return {};
+    }
+}
+
+std::string RaindropQueue::take_buffer()
+{
+    if (spare_buffers.empty())
+        return {};
+
+    auto buffer = std::move(spare_buffers.back());
+    spare_buffers.pop_back();
+    return buffer;
+}
+
+bool RaindropQueue::advance(Upload &upload, bool wait)
+{
+    while (!upload.result)
+    {
+        try
         {
-            std::cout << "[DEBUG] <<<<<<<<<< offload " << payload["items"].size() << " raindrops \n"
-                << "---------- request ----------" << std::endl;
-            std::cout << payload.dump(2) << std::endl;
-        }
+            if (upload.retry.valid())
+            {
+                if (!wait && !is_ready(upload.retry))
+                    return false;
+                upload.retry.get();
+            }
 
-        auto response = create_raindrops(account, payload);
+            if (!upload.response.valid())
+            {
+                send(upload);
+                continue;
+            }
 
-        if (response["items"].size() != payload["items"].size())
+            if (!wait && !is_ready(upload.response))
+                return false;
+            upload.result = receive(upload);
+        }
+        catch (const RaindropError& e)
         {
-            std::cerr << "[WARNING] Expected " << payload["items"].size() << " raindrops to be created, but only " << response["items"].size() << " came.\n"
-                << "Response: <<EOF\n" << response.dump() << "\nEOF" << std::endl;
+            if (!e.transient() || upload.attempt + 1 >= max_upload_attempts)
+                throw;
+
+            // the backoff is a timer of the http engine, so no thread sleeps through it
+            const auto delay = backoff_delay(upload.attempt);
+            std::cerr << "[WARNING] " << e.what() << ". Retrying in " << delay.count() << "ms (attempt "
+                << upload.attempt + 2 << " of " << max_upload_attempts << ")" << std::endl;
+            upload.attempt++;
+            upload.retry = account.http->delay_async(delay);
         }
+    }
+
+    return true;
+}
+
+void RaindropQueue::send(Upload &upload) const
+{
+    // the failed request may have created some of the raindrops before failing
+    if (upload.attempt > 0 && replay_filter)
+    {
+        for (auto& item : replay_filter(upload.batch))
+            upload.recovered.push_back(std::move(item));
 
         if (App::VERBOSE)
-        {
-            std::cout << "---------- response ----------" << std::endl;
-            std::cout << response.dump(2) << std::endl;
+            std::cout << "[DEBUG] " << upload.recovered.size() << " raindrops of the batch were already created" << std::endl;
+    }
+
+    if (upload.batch["items"].empty())
+    {
+        upload.result = nlohmann::json{ { "items", std::move(upload.recovered) } };
+        return;
+    }
+
+    // serialized once, then sent and logged from the same buffer
+    serialize(upload.batch, upload.body);
+
+    if (App::VERBOSE)
+    {
+        std::cout << "[DEBUG] <<<<<<<<<< offload " << upload.batch["items"].size() << " raindrops \n"
+            << "---------- request ----------" << std::endl;
+        std::cout << upload.body << std::endl;
+    }
+
+    upload.response = send_raindrops_async_view(account, upload.body);
+}
+
+nlohmann::json RaindropQueue::receive(Upload &upload) const
+{
+    auto response = created_raindrops(upload.response.get());
+
+    if (response["items"].size() != upload.batch["items"].size())
+    {
+        std::cerr << "[WARNING] Expected " << upload.batch["items"].size() << " raindrops to be created, but only " << response["items"].size() << " came.\n"
+            << "Response: <<EOF\n" << response.dump() << "\nEOF" << std::endl;
+    }
+
+    if (App::VERBOSE)
+    {
+        std::cout << "---------- response ----------" << std::endl;
+        std::cout << response.dump(2) << std::endl;
+
+        std::cout << "[DEBUG] >>>>>>>>>>" << std::endl;
+    }
+
+    for (auto& item : upload.recovered)
+        response["items"].push_back(std::move(item));
+    return response;
+}
 
-            std::cout << "[DEBUG] >>>>>>>>>>" << std::endl;
+void RaindropQueue::submit()
+{
+    // double buffering: the caller only waits when every slot is taken
+    while (static_cast<int>(uploads.size()) >= max_in_flight)
+        drain(true);
+
+    uploads.emplace_back(std::move(payload), take_buffer());
+    init_payload();
+
+    // sends the new batch
+    drain(false);
+}
+
+void RaindropQueue::drain(bool wait_oldest)
+{
+    bool oldest = true;
+    for (auto itr = uploads.begin(); itr != uploads.end(); oldest = false)
+    {
+        try
+        {
+            if (!advance(*itr, wait_oldest && oldest))
+            {
+                ++itr;
+                continue;
+            }
+            responses.push_back(std::move(*itr->result));
+        }
+        catch (...)
+        {
+            if (!failure)
+                failure = std::current_exception();
         }
 
-        init_payload();
-        return response;
+        spare_buffers.push_back(std::move(itr->body));
+        itr = uploads.erase(itr);
+    }
+}
+
+std::optional<nlohmann::json> RaindropQueue::collect(bool wait_all)
+{
+    if (wait_all)
+    {
+        while (!uploads.empty())
+            drain(true);
     }
     else
     {
+        drain(false);
+    }
+
+    auto done = std::move(responses);
+    responses.clear();
+    auto error = std::exchange(failure, nullptr);
+
+    if (done.empty())
+    {
+        if (error)
+            std::rethrow_exception(error);
         return {};
     }
+
+    // report every finished batch as if it was a single response
+    nlohmann::json merged = { { "items", nlohmann::json::array() } };
+    auto& items = merged["items"];
+    for (auto& response : done)
+    {
+        for (auto& item : response["items"])
+            items.push_back(std::move(item));
+    }
+
+    // the batches that were created must be reported even when another one failed, or they would
+    // be created again by the retry
+    if (observer)
+        observer(merged);
+
+    if (error)
+        std::rethrow_exception(error);
+
+    return merged;
 }
 
 void RaindropQueue::init_payload()
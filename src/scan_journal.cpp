@@ -0,0 +1,173 @@
+#include <scan_journal.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    template<typename T>
+    bool read_value(const char*& cursor, const char* end, T& value)
+    {
+        if (static_cast<size_t>(end - cursor) < sizeof(T))
+            return false;
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+
+    bool read_name(const char*& cursor, const char* end, std::string& name)
+    {
+        uint32_t size;
+        if (!read_value(cursor, end, size) || static_cast<size_t>(end - cursor) < size)
+            return false;
+        name.assign(cursor, size);
+        cursor += size;
+        return true;
+    }
+
+    template<typename T>
+    void write_value(std::ofstream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void write_name(std::ofstream& out, std::string_view name)
+    {
+        write_value(out, static_cast<uint32_t>(name.size()));
+        out.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+
+    void copy_fingerprint(std::string_view fingerprint, char (&out)[16])
+    {
+        std::memset(out, 0, sizeof(out));
+        std::memcpy(out, fingerprint.data(), std::min(fingerprint.size(), sizeof(out)));
+    }
+}
+
+bool ScanJournal::load(const fs::path &file, std::string_view fingerprint)
+{
+    directories.clear();
+
+    std::ifstream in{ file, std::ios::binary };
+    if (!in.is_open())
+        return false;
+    const std::string content{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} };
+
+    const char* cursor = content.data();
+    const char* const end = content.data() + content.size();
+
+    JournalHeader header;
+    char expected_fingerprint[16];
+    copy_fingerprint(fingerprint, expected_fingerprint);
+    if (!read_value(cursor, end, header)
+        || std::memcmp(header.magic, JournalHeader::magic_value, sizeof(header.magic)) != 0
+        || header.version != JournalHeader::current_version
+        || std::memcmp(header.fingerprint, expected_fingerprint, sizeof(expected_fingerprint)) != 0)
+    {
+        return false;
+    }
+
+    // filled aside, so a truncated journal never leaves half of its directories behind
+    decltype(directories) loaded;
+    for (uint64_t i = 0; i < header.directory_count; i++)
+    {
+        JournalDirectory directory;
+        uint32_t subdir_count, file_count;
+        std::string path;
+        if (!read_value(cursor, end, directory.stamp.device) || !read_value(cursor, end, directory.stamp.inode)
+            || !read_value(cursor, end, directory.stamp.mtime) || !read_value(cursor, end, directory.excluded)
+            || !read_value(cursor, end, subdir_count) || !read_value(cursor, end, file_count)
+            || !read_name(cursor, end, path))
+        {
+            return false;
+        }
+
+        // every name takes at least its size, which bounds the counts of a corrupted record
+        if (static_cast<uint64_t>(subdir_count) + file_count > static_cast<size_t>(end - cursor) / sizeof(uint32_t))
+            return false;
+
+        directory.subdirs.resize(subdir_count);
+        for (auto& subdir : directory.subdirs)
+        {
+            if (!read_name(cursor, end, subdir))
+                return false;
+        }
+
+        directory.files.resize(file_count);
+        for (auto& name : directory.files)
+        {
+            if (!read_name(cursor, end, name))
+                return false;
+        }
+
+        loaded.insert_or_assign(std::move(path), std::move(directory));
+    }
+
+    directories = std::move(loaded);
+    return true;
+}
+
+bool ScanJournal::save(const fs::path &file, std::string_view fingerprint) const
+{
+    std::error_code ec;
+    if (file.has_parent_path())
+        fs::create_directories(file.parent_path(), ec);
+    if (ec)
+        return false;
+
+    auto tmp_file = file;
+    tmp_file += ".tmp";
+
+    {
+        std::ofstream out{ tmp_file, std::ios::binary | std::ios::trunc };
+        if (!out.is_open())
+            return false;
+
+        JournalHeader header{};
+        std::memcpy(header.magic, JournalHeader::magic_value, sizeof(header.magic));
+        header.version = JournalHeader::current_version;
+        copy_fingerprint(fingerprint, header.fingerprint);
+        header.directory_count = directories.size();
+        write_value(out, header);
+
+        for (const auto& [path, directory] : directories)
+        {
+            write_value(out, directory.stamp.device);
+            write_value(out, directory.stamp.inode);
+            write_value(out, directory.stamp.mtime);
+            write_value(out, directory.excluded);
+            write_value(out, static_cast<uint32_t>(directory.subdirs.size()));
+            write_value(out, static_cast<uint32_t>(directory.files.size()));
+            write_name(out, path);
+            for (const auto& subdir : directory.subdirs)
+                write_name(out, subdir);
+            for (const auto& name : directory.files)
+                write_name(out, name);
+        }
+
+        if (!out)
+        {
+            out.close();
+            fs::remove(tmp_file, ec);
+            return false;
+        }
+    }
+
+    fs::rename(tmp_file, file, ec);
+    return !ec;
+}
+
+const JournalDirectory* ScanJournal::find(const fs::path &relative_dir) const
+{
+    auto itr = directories.find(relative_dir.generic_string());
+    return itr != directories.end() ? &itr->second : nullptr;
+}
+
+void ScanJournal::insert_or_assign(const fs::path &relative_dir, JournalDirectory directory)
+{
+    directories.insert_or_assign(relative_dir.generic_string(), std::move(directory));
+}
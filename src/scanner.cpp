@@ -0,0 +1,360 @@
+#include <scanner.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sys/syscall.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    /// @brief Directories waiting to be listed by one walker thread
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<fs::path> dirs;
+    };
+
+    /// @brief Closes a file descriptor when leaving the scope
+    struct FileDescriptor
+    {
+        int fd;
+        FileDescriptor(int fd) : fd(fd) {}
+        FileDescriptor(const FileDescriptor&) = delete;
+        FileDescriptor& operator=(const FileDescriptor&) = delete;
+        ~FileDescriptor()
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+    };
+
+    EntryKind kind_of(const fs::directory_entry& entry)
+    {
+        std::error_code ec;
+        if (entry.is_symlink(ec))
+            return entry.is_regular_file(ec) ? EntryKind::regular : EntryKind::other;
+        if (entry.is_directory(ec))
+            return EntryKind::directory;
+        if (entry.is_regular_file(ec))
+            return EntryKind::regular;
+        return EntryKind::other;
+    }
+
+    DirectoryStamp stamp_of(const struct stat& st)
+    {
+        return DirectoryStamp{
+            static_cast<uint64_t>(st.st_dev),
+            static_cast<uint64_t>(st.st_ino),
+            static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec
+        };
+    }
+
+    std::optional<DirectoryStamp> read_stamp(const fs::path& dir)
+    {
+        struct stat st;
+        if (::stat(dir.c_str(), &st) != 0)
+            return std::nullopt;
+        return stamp_of(st);
+    }
+
+#ifdef __linux__
+    /// @brief Record returned by getdents64, which glibc only declares in recent versions
+    struct LinuxDirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    /// @brief Kind of an entry that is a link, or whose type was not in the listing
+    EntryKind kind_at(int dir_fd, const char* name, unsigned char type)
+    {
+        struct stat st;
+        if (type == DT_UNKNOWN)
+        {
+            if (::fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                return EntryKind::other;
+            if (S_ISDIR(st.st_mode))
+                return EntryKind::directory;
+            if (S_ISREG(st.st_mode))
+                return EntryKind::regular;
+            if (!S_ISLNK(st.st_mode))
+                return EntryKind::other;
+        }
+
+        // like with the iterator, a link counts as a file when it points to one
+        if (::fstatat(dir_fd, name, &st, 0) != 0)
+            return EntryKind::other;
+        return S_ISREG(st.st_mode) ? EntryKind::regular : EntryKind::other;
+    }
+#endif
+}
+
+DirectoryWalker::DirectoryWalker(int threads, bool recursive, ScanBackend backend)
+    : threads(threads > 0 ? static_cast<size_t>(threads) : std::max(1u, std::thread::hardware_concurrency())),
+    recursive(recursive),
+    backend(backend)
+{
+    if (!recursive)
+        this->threads = 1;
+}
+
+size_t DirectoryWalker::walk(const fs::path &root, const ScanVisitor &visit) const
+{
+    std::vector<WorkQueue> queues(threads);
+    // directories queued or being listed. The walk is over when it drops to 0
+    std::atomic<size_t> pending{ 1 };
+    // directories waiting in the queues, not yet taken by a thread
+    std::atomic<size_t> queued{ 1 };
+    // threads without work wait here for a push, the end of the walk or an abort
+    std::mutex idle_mutex;
+    std::condition_variable idle;
+    std::atomic<size_t> failures{ 0 };
+    std::atomic<bool> aborted{ false };
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    queues[0].dirs.emplace_back();
+
+    auto take = [&](size_t self) -> std::optional<fs::path>
+    {
+        {
+            auto& own = queues[self];
+            std::lock_guard lock{ own.mutex };
+            if (!own.dirs.empty())
+            {
+                auto dir = std::move(own.dirs.back());
+                own.dirs.pop_back();
+                queued--;
+                return dir;
+            }
+        }
+
+        for (size_t i = 1; i < threads; i++)
+        {
+            auto& victim = queues[(self + i) % threads];
+            std::lock_guard lock{ victim.mutex };
+            if (!victim.dirs.empty())
+            {
+                auto dir = std::move(victim.dirs.front());
+                victim.dirs.pop_front();
+                queued--;
+                return dir;
+            }
+        }
+
+        return std::nullopt;
+    };
+
+    // the idle mutex is taken before notifying, so a thread that just found no work can not miss it
+    auto wake = [&](bool all)
+    {
+        std::lock_guard lock{ idle_mutex };
+        if (all)
+            idle.notify_all();
+        else
+            idle.notify_one();
+    };
+
+    auto push = [&](size_t self, fs::path dir)
+    {
+        pending++;
+        {
+            auto& own = queues[self];
+            std::lock_guard lock{ own.mutex };
+            own.dirs.push_back(std::move(dir));
+        }
+        queued++;
+        wake(false);
+    };
+
+    // asks the filter whether a directory is listed. When it is not, the subdirectories
+    // given by the filter are walked instead. Without a stamp it is always listed
+    auto enter = [&](size_t self, const fs::path& relative_dir, const std::optional<DirectoryStamp>& stamp)
+    {
+        std::vector<std::string> subdirs;
+        if (filter(self, relative_dir, stamp, subdirs) || !stamp)
+            return true;
+
+        if (recursive)
+        {
+            for (auto& subdir : subdirs)
+                push(self, relative_dir / subdir);
+        }
+        return false;
+    };
+
+    auto fail = [&](const fs::path& relative_dir, const char* what, const std::string& reason)
+    {
+        std::cerr << "[WARNING] Could not " << what << " " << root / relative_dir << ": " << reason << std::endl;
+        failures++;
+    };
+
+    auto list_iterator = [&](size_t self, const fs::path& relative_dir)
+    {
+        if (filter && !enter(self, relative_dir, read_stamp(root / relative_dir)))
+            return;
+
+        std::error_code ec;
+        fs::directory_iterator itr{ root / relative_dir, ec };
+        if (ec)
+            return fail(relative_dir, "read", ec.message());
+
+        for (; itr != fs::directory_iterator{}; itr.increment(ec))
+        {
+            if (ec)
+                return fail(relative_dir, "finish reading", ec.message());
+
+            const auto name = itr->path().filename().string();
+            const auto kind = kind_of(*itr);
+            visit(self, ScanEntry{ name, relative_dir, kind });
+
+            if (recursive && kind == EntryKind::directory)
+                push(self, relative_dir / name);
+        }
+    };
+
+#ifdef __linux__
+    // directories are opened relative to the root, so their full path is never resolved again
+    const FileDescriptor root_fd{ backend == ScanBackend::getdents ? ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1 };
+    const int root_errno = errno;
+
+    auto list_getdents = [&](size_t self, const fs::path& relative_dir)
+    {
+        if (root_fd.fd < 0)
+            return fail(relative_dir, "read", std::strerror(root_errno));
+
+        // subdirectories were listed as directories, so they are opened without following links
+        const FileDescriptor dir{ relative_dir.empty()
+            ? ::dup(root_fd.fd)
+            : ::openat(root_fd.fd, relative_dir.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC) };
+        if (dir.fd < 0)
+            return fail(relative_dir, "read", std::strerror(errno));
+
+        if (filter)
+        {
+            struct stat st;
+            const auto stamp = ::fstat(dir.fd, &st) == 0 ? std::optional{ stamp_of(st) } : std::nullopt;
+            if (!enter(self, relative_dir, stamp))
+                return;
+        }
+
+        alignas(LinuxDirent64) char buffer[32 * 1024];
+        while (true)
+        {
+            const auto size = ::syscall(SYS_getdents64, dir.fd, buffer, sizeof(buffer));
+            if (size < 0)
+                return fail(relative_dir, "finish reading", std::strerror(errno));
+            if (size == 0)
+                return;
+
+            for (long offset = 0; offset < size; )
+            {
+                const auto* entry = reinterpret_cast<const LinuxDirent64*>(buffer + offset);
+                offset += entry->d_reclen;
+
+                // a view into the buffer, valid until the next getdents64 call
+                const std::string_view name{ entry->d_name };
+                if (name == "." || name == "..")
+                    continue;
+
+                EntryKind kind;
+                switch (entry->d_type)
+                {
+                    case DT_REG:
+                        kind = EntryKind::regular;
+                        break;
+                    case DT_DIR:
+                        kind = EntryKind::directory;
+                        break;
+                    case DT_LNK:
+                    case DT_UNKNOWN:
+                        kind = kind_at(dir.fd, entry->d_name, entry->d_type);
+                        break;
+                    default:
+                        kind = EntryKind::other;
+                        break;
+                }
+
+                visit(self, ScanEntry{ name, relative_dir, kind });
+
+                if (recursive && kind == EntryKind::directory)
+                    push(self, relative_dir / name);
+            }
+        }
+    };
+#endif
+
+    auto list = [&](size_t self, const fs::path& relative_dir)
+    {
+#ifdef __linux__
+        if (backend == ScanBackend::getdents)
+            return list_getdents(self, relative_dir);
+#endif
+        list_iterator(self, relative_dir);
+    };
+
+    auto work = [&](size_t self)
+    {
+        while (!aborted)
+        {
+            auto dir = take(self);
+            if (!dir)
+            {
+                // the others are still listing and may find more directories
+                std::unique_lock lock{ idle_mutex };
+                idle.wait(lock, [&]() { return queued > 0 || pending == 0 || aborted; });
+                if (pending == 0 || aborted)
+                    return;
+                continue;
+            }
+
+            try
+            {
+                list(self, *dir);
+            }
+            catch (...)
+            {
+                std::lock_guard lock{ error_mutex };
+                if (!error)
+                    error = std::current_exception();
+                aborted = true;
+            }
+            if (--pending == 0 || aborted)
+                wake(true);
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < threads; i++)
+        helpers.emplace_back(work, i);
+    work(0);
+    for (auto& helper : helpers)
+        helper.join();
+
+    if (error)
+        std::rethrow_exception(error);
+
+    return failures;
+}
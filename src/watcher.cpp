@@ -0,0 +1,182 @@
+#include <watcher.h>
+
+#include <scanner.h>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef __linux__
+
+namespace
+{
+    constexpr uint32_t watched_events = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+    /// @brief Whether a path is below a directory or is the directory itself
+    bool is_within(const fs::path& path, const fs::path& dir)
+    {
+        auto itr = path.begin();
+        for (const auto& part : dir)
+        {
+            if (itr == path.end() || *itr != part)
+                return false;
+            ++itr;
+        }
+        return true;
+    }
+}
+
+DirectoryWatcher::DirectoryWatcher()
+    : fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+size_t DirectoryWatcher::watch(size_t mount, const fs::path &root, const fs::path &relative_dir, bool recursive, std::vector<WatchEvent> *found)
+{
+    if (!add(Watched{ mount, root, relative_dir, recursive }))
+        return 1;
+    if (!recursive && found == nullptr)
+        return 0;
+
+    size_t failures = 0;
+    const DirectoryWalker walker{ 1, recursive };
+    failures += walker.walk(root / relative_dir, [&](size_t, const ScanEntry& entry)
+    {
+        const auto dir = relative_dir / entry.relative_dir;
+        if (entry.kind == EntryKind::directory && recursive)
+        {
+            // watched before its own entries are visited, so no file falls in between
+            if (!add(Watched{ mount, root, dir / entry.name, recursive }))
+                failures++;
+        }
+        else if (entry.kind == EntryKind::regular && found != nullptr)
+        {
+            found->push_back(WatchEvent{ mount, dir, std::string{ entry.name } });
+        }
+    });
+
+    return failures;
+}
+
+bool DirectoryWatcher::add(const Watched &watched)
+{
+    // the mount path itself may be a link, the directories below it are never followed
+    const auto flags = watched.relative_dir.empty() ? watched_events : watched_events | IN_DONT_FOLLOW;
+    const int wd = inotify_add_watch(fd, (watched.root / watched.relative_dir).c_str(), flags);
+    if (wd < 0)
+    {
+        std::cerr << "[WARNING] Could not watch " << watched.root / watched.relative_dir << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    watches.insert_or_assign(wd, watched);
+    return true;
+}
+
+void DirectoryWatcher::remove_tree(size_t mount, const fs::path &relative_dir)
+{
+    for (auto itr = watches.begin(); itr != watches.end(); )
+    {
+        if (itr->second.mount == mount && is_within(itr->second.relative_dir, relative_dir))
+        {
+            inotify_rm_watch(fd, itr->first);
+            itr = watches.erase(itr);
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+}
+
+bool DirectoryWatcher::wait(std::chrono::milliseconds timeout, std::vector<WatchEvent> &events)
+{
+    pollfd pfd{ fd, POLLIN, 0 };
+    if (::poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0)
+        return true;
+
+    bool complete = true;
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (true)
+    {
+        const auto size = ::read(fd, buffer, sizeof(buffer));
+        if (size <= 0)
+            break;
+
+        for (const char* cursor = buffer; cursor < buffer + size; )
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(cursor);
+            cursor += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                complete = false;
+                continue;
+            }
+
+            auto itr = watches.find(event->wd);
+            if (itr == watches.end())
+                continue;
+            if (event->mask & IN_IGNORED)
+            {
+                // the directory was deleted or unmounted
+                watches.erase(itr);
+                continue;
+            }
+
+            // copied, since watching new directories may rehash the watches
+            const auto watched = itr->second;
+            const std::string name{ event->len > 0 ? event->name : "" };
+            const auto dir = watched.relative_dir / name;
+
+            if (event->mask & IN_ISDIR)
+            {
+                if (!watched.recursive)
+                    continue;
+                // a moved directory is watched again from its new place
+                if (event->mask & IN_MOVED_FROM)
+                    remove_tree(watched.mount, dir);
+                else if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    watch(watched.mount, watched.root, dir, true, &events);
+            }
+            else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+            {
+                events.push_back(WatchEvent{ watched.mount, watched.relative_dir, name });
+            }
+        }
+    }
+
+    return complete;
+}
+
+#else
+
+DirectoryWatcher::DirectoryWatcher() = default;
+
+DirectoryWatcher::~DirectoryWatcher() = default;
+
+size_t DirectoryWatcher::watch(size_t, const fs::path &, const fs::path &, bool, std::vector<WatchEvent> *)
+{
+    return 1;
+}
+
+bool DirectoryWatcher::wait(std::chrono::milliseconds, std::vector<WatchEvent> &)
+{
+    return false;
+}
+
+#endif
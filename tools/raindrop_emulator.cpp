@@ -0,0 +1,870 @@
+// Local emulator of the parts of the raindrop.io api used by folderdrop, for load tests and
+// benchmarks that must not touch the real service. Point folderdrop at it with --api-url.
+//
+// Everything lives in memory and is lost when the emulator stops. Only plain HTTP/1.1 is spoken.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+#include <zlib.h>
+
+namespace
+{
+    constexpr auto help_message = R"(raindrop-emulator: local emulator of the raindrop.io api
+
+usage: raindrop-emulator [options]
+    options:
+        -h, --help          show this message
+        -v, --verbose       log every request
+        --port              port to listen on (default: 8787)
+        --latency           milliseconds added to every response (default: 0)
+        --jitter            up to this many milliseconds added at random to every response (default: 0)
+        --error-rate        fraction of requests answered with 503, between 0 and 1 (default: 0)
+        --partial-writes    failed bulk creates still create the first half of their raindrops
+        --rate-limit        requests per minute for each token, 0 for unlimited (default: 120)
+        --collections       comma separated collections to create. Nested ones as Parent/Child (default: Emulated)
+        --raindrops         raindrops created in each collection at startup (default: 0)
+)";
+
+    struct Options
+    {
+        uint16_t port = 8787;
+        int latency_ms = 0;
+        int jitter_ms = 0;
+        double error_rate = 0;
+        bool partial_writes = false;
+        int rate_limit = 120;
+        std::vector<std::string> collections{ "Emulated" };
+        int raindrops = 0;
+        bool verbose = false;
+    };
+
+    struct Request
+    {
+        std::string method;
+        std::string path;
+        std::map<std::string, std::string> query;
+        /** Header names are lower case */
+        std::map<std::string, std::string> headers;
+        std::string body;
+    };
+
+    struct Response
+    {
+        int status = 200;
+        nlohmann::json body;
+        std::vector<std::pair<std::string, std::string>> headers;
+    };
+
+    struct StoredRaindrop
+    {
+        uint64_t id;
+        uint64_t collection;
+        std::string link;
+        std::string title;
+        nlohmann::json tags;
+        int64_t created;
+        int64_t last_update;
+    };
+
+    struct StoredCollection
+    {
+        uint64_t id;
+        std::string title;
+        /** 0 for root collections */
+        uint64_t parent;
+        /** Raindrops in creation order */
+        std::vector<uint64_t> raindrops;
+    };
+
+    std::string iso_date(int64_t unix_time)
+    {
+        const auto time = static_cast<std::time_t>(unix_time);
+        std::tm tm{};
+        gmtime_r(&time, &tm);
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S.000Z", &tm);
+        return buffer;
+    }
+
+    int64_t unix_now()
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    std::string to_lower(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+        return text;
+    }
+
+    std::string percent_decode(std::string_view text)
+    {
+        std::string decoded;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            if (text[i] == '+')
+            {
+                decoded += ' ';
+            }
+            else if (text[i] == '%' && i + 2 < text.size())
+            {
+                int value = 0;
+                std::from_chars(text.data() + i + 1, text.data() + i + 3, value, 16);
+                decoded += static_cast<char>(value);
+                i += 2;
+            }
+            else
+            {
+                decoded += text[i];
+            }
+        }
+        return decoded;
+    }
+
+    std::optional<std::string> gunzip(const std::string& body)
+    {
+        z_stream stream{};
+        // 15 + 32: detect gzip or zlib headers
+        if (inflateInit2(&stream, 15 + 32) != Z_OK)
+            return std::nullopt;
+
+        std::string inflated;
+        char buffer[16384];
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+        stream.avail_in = static_cast<uInt>(body.size());
+
+        int status = Z_OK;
+        while (status == Z_OK)
+        {
+            stream.next_out = reinterpret_cast<Bytef*>(buffer);
+            stream.avail_out = sizeof(buffer);
+            status = inflate(&stream, Z_NO_FLUSH);
+            inflated.append(buffer, sizeof(buffer) - stream.avail_out);
+        }
+        inflateEnd(&stream);
+
+        if (status != Z_STREAM_END)
+            return std::nullopt;
+        return inflated;
+    }
+
+    std::optional<std::string> gzip(const std::string& body)
+    {
+        z_stream stream{};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return std::nullopt;
+
+        std::string compressed(deflateBound(&stream, static_cast<uLong>(body.size())), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+        stream.avail_in = static_cast<uInt>(body.size());
+        stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+        stream.avail_out = static_cast<uInt>(compressed.size());
+
+        const auto status = deflate(&stream, Z_FINISH);
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        if (status != Z_STREAM_END)
+            return std::nullopt;
+        return compressed;
+    }
+
+    /// @brief Raindrops and collections of the emulated account. Shared by every connection
+    class Store
+    {
+    public:
+        uint64_t add_collection(const std::string& title, uint64_t parent)
+        {
+            std::lock_guard lock{ mutex };
+            const auto id = next_collection_id++;
+            collections[id] = StoredCollection{ id, title, parent, {} };
+            return id;
+        }
+
+        std::optional<uint64_t> find_collection(const std::string& title, uint64_t parent)
+        {
+            std::lock_guard lock{ mutex };
+            for (const auto& [id, collection] : collections)
+            {
+                if (collection.title == title && collection.parent == parent)
+                    return id;
+            }
+            return std::nullopt;
+        }
+
+        /// @return The created raindrop, or nullopt when the collection does not exist
+        std::optional<nlohmann::json> create(const nlohmann::json& item)
+        {
+            std::lock_guard lock{ mutex };
+
+            const auto col = item.contains("collection") ? item["collection"].value("$id", uint64_t{ 0 }) : collections.begin()->first;
+            auto collection = collections.find(col);
+            if (collection == collections.end() || !item.contains("link"))
+                return std::nullopt;
+
+            const auto now = unix_now();
+            StoredRaindrop raindrop{ next_raindrop_id++, col, item["link"].get<std::string>(), item.value("title", std::string{}),
+                item.value("tags", nlohmann::json::array()), now, now };
+            collection->second.raindrops.push_back(raindrop.id);
+            by_link[raindrop.link].push_back(raindrop.id);
+            auto json = to_json(raindrop);
+            raindrops.emplace(raindrop.id, std::move(raindrop));
+            return json;
+        }
+
+        std::optional<nlohmann::json> raindrop(uint64_t id)
+        {
+            std::lock_guard lock{ mutex };
+            auto itr = raindrops.find(id);
+            if (itr == raindrops.end())
+                return std::nullopt;
+            return to_json(itr->second);
+        }
+
+        std::vector<uint64_t> ids_of(const std::string& link)
+        {
+            std::lock_guard lock{ mutex };
+            auto itr = by_link.find(link);
+            return itr == by_link.end() ? std::vector<uint64_t>{} : itr->second;
+        }
+
+        std::optional<nlohmann::json> collection(uint64_t id)
+        {
+            std::lock_guard lock{ mutex };
+            auto itr = collections.find(id);
+            if (itr == collections.end())
+                return std::nullopt;
+            return to_json(itr->second);
+        }
+
+        nlohmann::json collections_json(bool nested)
+        {
+            std::lock_guard lock{ mutex };
+            auto items = nlohmann::json::array();
+            for (const auto& [id, collection] : collections)
+            {
+                if ((collection.parent != 0) == nested)
+                    items.push_back(to_json(collection));
+            }
+            return items;
+        }
+
+        /// @return The page and the number of raindrops matching the search, or nullopt when the collection does not exist
+        std::optional<std::pair<nlohmann::json, size_t>> page(uint64_t col, size_t page, size_t perpage, const std::string& search, bool newest_first)
+        {
+            std::lock_guard lock{ mutex };
+            auto collection = collections.find(col);
+            if (collection == collections.end())
+                return std::nullopt;
+
+            // the only search folderdrop makes is lastUpdate:>YYYY-MM-DD, anything else matches link and title
+            int64_t updated_after = std::numeric_limits<int64_t>::min();
+            std::string text = search;
+            if (search.rfind("lastUpdate:>", 0) == 0)
+            {
+                std::tm tm{};
+                if (strptime(search.c_str() + std::strlen("lastUpdate:>"), "%Y-%m-%d", &tm) != nullptr)
+                    updated_after = static_cast<int64_t>(timegm(&tm));
+                text.clear();
+            }
+
+            std::vector<const StoredRaindrop*> matches;
+            for (const auto id : collection->second.raindrops)
+            {
+                const auto& raindrop = raindrops.at(id);
+                if (raindrop.last_update < updated_after)
+                    continue;
+                if (!text.empty() && raindrop.link.find(text) == std::string::npos && raindrop.title.find(text) == std::string::npos)
+                    continue;
+                matches.push_back(&raindrop);
+            }
+
+            if (newest_first)
+                std::reverse(matches.begin(), matches.end());
+
+            auto items = nlohmann::json::array();
+            for (auto i = page * perpage; i < matches.size() && i < (page + 1) * perpage; i++)
+                items.push_back(to_json(*matches[i]));
+
+            return std::make_pair(std::move(items), matches.size());
+        }
+    private:
+        static nlohmann::json to_json(const StoredRaindrop& raindrop)
+        {
+            return {
+                { "_id", raindrop.id },
+                { "link", raindrop.link },
+                { "title", raindrop.title },
+                { "excerpt", "" },
+                { "type", "link" },
+                { "tags", raindrop.tags },
+                { "collection", { { "$ref", "collections" }, { "$id", raindrop.collection } } },
+                { "collectionId", raindrop.collection },
+                { "created", iso_date(raindrop.created) },
+                { "lastUpdate", iso_date(raindrop.last_update) }
+            };
+        }
+
+        nlohmann::json to_json(const StoredCollection& collection) const
+        {
+            nlohmann::json json = {
+                { "_id", collection.id },
+                { "title", collection.title },
+                { "count", collection.raindrops.size() }
+            };
+            if (collection.parent != 0)
+                json["parent"] = { { "$ref", "collections" }, { "$id", collection.parent } };
+            return json;
+        }
+    private:
+        std::mutex mutex;
+        std::map<uint64_t, StoredCollection> collections;
+        std::unordered_map<uint64_t, StoredRaindrop> raindrops;
+        std::unordered_map<std::string, std::vector<uint64_t>> by_link;
+        uint64_t next_collection_id = 1000;
+        uint64_t next_raindrop_id = 100000000;
+    };
+
+    /// @brief Fixed one minute windows of requests, counted per token
+    class RateLimits
+    {
+    public:
+        explicit RateLimits(int limit) : limit(limit) {}
+
+        /// @return False when the token used up its window. The rate limit headers are added to response
+        bool admit(const std::string& token, Response& response)
+        {
+            if (limit <= 0)
+                return true;
+
+            std::lock_guard lock{ mutex };
+            const auto now = unix_now();
+            auto& window = windows[token];
+            if (now >= window.reset)
+                window = Window{ now + 60, 0 };
+
+            const bool admitted = window.used < limit;
+            if (admitted)
+                window.used++;
+
+            response.headers.emplace_back("X-RateLimit-Limit", std::to_string(limit));
+            response.headers.emplace_back("X-RateLimit-Remaining", std::to_string(limit - window.used));
+            response.headers.emplace_back("X-RateLimit-Reset", std::to_string(window.reset));
+            if (!admitted)
+                response.headers.emplace_back("Retry-After", std::to_string(std::max<int64_t>(window.reset - now, 1)));
+            return admitted;
+        }
+    private:
+        struct Window
+        {
+            int64_t reset = 0;
+            int used = 0;
+        };
+
+        const int limit;
+        std::mutex mutex;
+        std::unordered_map<std::string, Window> windows;
+    };
+
+    class Emulator
+    {
+    public:
+        explicit Emulator(Options options) : options(std::move(options)), limits(this->options.rate_limit) {}
+
+        void seed()
+        {
+            for (const auto& path : options.collections)
+            {
+                // every part of the path is a collection under the previous one
+                uint64_t parent = 0;
+                uint64_t id = 0;
+                for (size_t begin = 0; begin <= path.size(); )
+                {
+                    auto end = path.find('/', begin);
+                    if (end == std::string::npos)
+                        end = path.size();
+                    const auto title = path.substr(begin, end - begin);
+                    id = store.find_collection(title, parent).value_or(0);
+                    if (id == 0)
+                        id = store.add_collection(title, parent);
+                    parent = id;
+                    begin = end + 1;
+                }
+
+                for (int i = 0; i < options.raindrops; i++)
+                {
+                    store.create({
+                        { "link", "https://emulated.invalid/" + std::to_string(id) + "/seed-" + std::to_string(i) },
+                        { "title", "seed-" + std::to_string(i) },
+                        { "collection", { { "$id", id } } }
+                    });
+                }
+            }
+        }
+
+        /// @brief Answers a request. A request the emulator can not make sense of is answered
+        /// with 400, so it never takes the server down
+        Response handle(const Request& request)
+        {
+            try
+            {
+                return route(request);
+            }
+            catch (const std::exception& e)
+            {
+                return error(400, std::string{ "Bad request: " } + e.what());
+            }
+        }
+
+        const Options& get_options() const { return options; }
+    private:
+        Response route(const Request& request)
+        {
+            Response response;
+
+            auto authorization = request.headers.find("authorization");
+            if (authorization == request.headers.end() || authorization->second.rfind("Bearer ", 0) != 0)
+                return error(401, "Missing token");
+
+            if (!limits.admit(authorization->second, response))
+            {
+                response.status = 429;
+                response.body = { { "result", false }, { "errorMessage", "Too many requests" } };
+                return response;
+            }
+
+            const bool failure = options.error_rate > 0 && random_unit() < options.error_rate;
+            if (failure && !(options.partial_writes && request.method == "POST" && request.path == "/rest/v1/raindrops"))
+                return error(503, "Injected failure");
+
+            nlohmann::json body;
+            if (request.method == "POST")
+            {
+                body = nlohmann::json::parse(request.body, nullptr, false);
+                if (body.is_discarded())
+                    return error(400, "Malformed body");
+            }
+
+            const auto& path = request.path;
+            if (request.method == "GET" && path == "/rest/v1/collections")
+            {
+                response.body = { { "result", true }, { "items", store.collections_json(false) } };
+            }
+            else if (request.method == "GET" && path == "/rest/v1/collections/childrens")
+            {
+                response.body = { { "result", true }, { "items", store.collections_json(true) } };
+            }
+            else if (request.method == "GET" && path.rfind("/rest/v1/collection/", 0) == 0)
+            {
+                auto collection = store.collection(id_at(path, "/rest/v1/collection/"));
+                if (!collection)
+                    return error(404, "No such collection");
+                response.body = { { "result", true }, { "item", std::move(*collection) } };
+            }
+            else if (request.method == "GET" && path.rfind("/rest/v1/raindrops/", 0) == 0)
+            {
+                const auto page = std::stoul(query(request, "page", "0"));
+                const auto perpage = std::stoul(query(request, "perpage", "25"));
+                const bool newest_first = query(request, "sort", "-created") != "created";
+                auto result = store.page(id_at(path, "/rest/v1/raindrops/"), page, perpage, query(request, "search", ""), newest_first);
+                if (!result)
+                    return error(404, "No such collection");
+                response.body = { { "result", true }, { "items", std::move(result->first) }, { "count", result->second } };
+            }
+            else if (request.method == "GET" && path.rfind("/rest/v1/raindrop/", 0) == 0)
+            {
+                auto raindrop = store.raindrop(id_at(path, "/rest/v1/raindrop/"));
+                if (!raindrop)
+                    return error(404, "No such raindrop");
+                response.body = { { "result", true }, { "item", std::move(*raindrop) } };
+            }
+            else if (request.method == "POST" && path == "/rest/v1/raindrop")
+            {
+                auto raindrop = store.create(body);
+                if (!raindrop)
+                    return error(400, "Invalid raindrop");
+                response.body = { { "result", true }, { "item", std::move(*raindrop) } };
+            }
+            else if (request.method == "POST" && path == "/rest/v1/raindrops")
+            {
+                const auto& items = body["items"];
+                if (!items.is_array() || items.size() > 100)
+                    return error(400, "items must be an array of up to 100 raindrops");
+
+                // a partial write creates the first half of the batch and then fails, like a timeout would
+                const auto to_create = failure ? items.size() / 2 : items.size();
+                auto created = nlohmann::json::array();
+                for (size_t i = 0; i < to_create; i++)
+                {
+                    if (auto raindrop = store.create(items[i]))
+                        created.push_back(std::move(*raindrop));
+                }
+
+                if (failure)
+                    return error(502, "Injected failure after a partial write");
+                response.body = { { "result", true }, { "items", std::move(created) } };
+            }
+            else if (request.method == "POST" && path == "/rest/v1/import/url/exists")
+            {
+                auto ids = nlohmann::json::array();
+                for (const auto& url : body["urls"])
+                {
+                    for (const auto id : store.ids_of(url.get<std::string>()))
+                        ids.push_back(id);
+                }
+                const bool found = !ids.empty();
+                response.body = { { "result", found }, { "ids", std::move(ids) }, { "duplicates", nlohmann::json::array() } };
+            }
+            else
+            {
+                return error(404, "Not emulated: " + request.method + " " + path);
+            }
+
+            return response;
+        }
+
+        static Response error(int status, const std::string& message)
+        {
+            return Response{ status, { { "result", false }, { "errorMessage", message } }, {} };
+        }
+
+        static uint64_t id_at(const std::string& path, std::string_view prefix)
+        {
+            uint64_t id = 0;
+            std::from_chars(path.data() + prefix.size(), path.data() + path.size(), id);
+            return id;
+        }
+
+        static std::string query(const Request& request, const std::string& name, const std::string& fallback)
+        {
+            auto itr = request.query.find(name);
+            return itr == request.query.end() ? fallback : itr->second;
+        }
+
+        double random_unit()
+        {
+            std::lock_guard lock{ random_mutex };
+            return std::uniform_real_distribution<double>{ 0, 1 }(random);
+        }
+    public:
+        int latency()
+        {
+            if (options.jitter_ms <= 0)
+                return options.latency_ms;
+            std::lock_guard lock{ random_mutex };
+            return options.latency_ms + std::uniform_int_distribution<int>{ 0, options.jitter_ms }(random);
+        }
+    private:
+        const Options options;
+        Store store;
+        RateLimits limits;
+        std::mutex random_mutex;
+        std::mt19937 random{ std::random_device{}() };
+    };
+
+    /// @brief Reads from a socket, buffering what comes after the current request
+    class Connection
+    {
+    public:
+        explicit Connection(int fd) : fd(fd) {}
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+        ~Connection() { ::close(fd); }
+
+        std::optional<Request> read_request()
+        {
+            size_t header_end;
+            while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos)
+            {
+                if (!fill())
+                    return std::nullopt;
+            }
+
+            Request request;
+            std::string_view head{ buffer.data(), header_end };
+            auto line_end = head.find("\r\n");
+            const auto request_line = head.substr(0, line_end);
+
+            const auto method_end = request_line.find(' ');
+            const auto target_end = request_line.find(' ', method_end + 1);
+            if (method_end == std::string_view::npos || target_end == std::string_view::npos)
+                return std::nullopt;
+            request.method = std::string{ request_line.substr(0, method_end) };
+            const auto target = request_line.substr(method_end + 1, target_end - method_end - 1);
+
+            const auto query_begin = target.find('?');
+            request.path = std::string{ target.substr(0, query_begin) };
+            // trailing slashes are not significant to the api
+            while (request.path.size() > 1 && request.path.back() == '/')
+                request.path.pop_back();
+            if (query_begin != std::string_view::npos)
+            {
+                auto query = target.substr(query_begin + 1);
+                while (!query.empty())
+                {
+                    const auto amp = query.find('&');
+                    const auto pair = query.substr(0, amp);
+                    const auto eq = pair.find('=');
+                    request.query[percent_decode(pair.substr(0, eq))] = eq == std::string_view::npos ? "" : percent_decode(pair.substr(eq + 1));
+                    query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+                }
+            }
+
+            while (line_end != std::string_view::npos)
+            {
+                const auto begin = line_end + 2;
+                line_end = head.find("\r\n", begin);
+                const auto line = head.substr(begin, line_end == std::string_view::npos ? std::string_view::npos : line_end - begin);
+                const auto colon = line.find(':');
+                if (colon == std::string_view::npos)
+                    continue;
+                auto value = line.substr(colon + 1);
+                while (!value.empty() && value.front() == ' ')
+                    value.remove_prefix(1);
+                request.headers[to_lower(std::string{ line.substr(0, colon) })] = std::string{ value };
+            }
+
+            buffer.erase(0, header_end + 4);
+
+            if (auto expect = request.headers.find("expect"); expect != request.headers.end() && to_lower(expect->second) == "100-continue")
+                write("HTTP/1.1 100 Continue\r\n\r\n");
+
+            size_t content_length = 0;
+            if (auto length = request.headers.find("content-length"); length != request.headers.end())
+                std::from_chars(length->second.data(), length->second.data() + length->second.size(), content_length);
+
+            while (buffer.size() < content_length)
+            {
+                if (!fill())
+                    return std::nullopt;
+            }
+            request.body = buffer.substr(0, content_length);
+            buffer.erase(0, content_length);
+
+            if (auto encoding = request.headers.find("content-encoding"); encoding != request.headers.end() && encoding->second == "gzip")
+            {
+                auto inflated = gunzip(request.body);
+                if (!inflated)
+                    return std::nullopt;
+                request.body = std::move(*inflated);
+            }
+
+            return request;
+        }
+
+        bool write(std::string_view data)
+        {
+            while (!data.empty())
+            {
+                const auto sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+                if (sent <= 0)
+                    return false;
+                data.remove_prefix(static_cast<size_t>(sent));
+            }
+            return true;
+        }
+    private:
+        bool fill()
+        {
+            char chunk[16384];
+            const auto received = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (received <= 0)
+                return false;
+            buffer.append(chunk, static_cast<size_t>(received));
+            return true;
+        }
+    private:
+        const int fd;
+        std::string buffer;
+    };
+
+    const char* reason_of(int status)
+    {
+        switch (status)
+        {
+            case 200: return "OK";
+            case 400: return "Bad Request";
+            case 401: return "Unauthorized";
+            case 404: return "Not Found";
+            case 429: return "Too Many Requests";
+            case 502: return "Bad Gateway";
+            case 503: return "Service Unavailable";
+            default: return "Unknown";
+        }
+    }
+
+    void serve(Emulator& emulator, int fd)
+    {
+        Connection connection{ fd };
+
+        while (auto request = connection.read_request())
+        {
+            const auto started = std::chrono::steady_clock::now();
+            auto response = emulator.handle(*request);
+
+            // strings taken from requests may not be valid UTF-8, which dump would throw on
+            std::string body = response.body.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+            bool gzipped = false;
+            if (auto accept = request->headers.find("accept-encoding"); accept != request->headers.end()
+                && accept->second.find("gzip") != std::string::npos && body.size() >= 1024)
+            {
+                if (auto compressed = gzip(body))
+                {
+                    body = std::move(*compressed);
+                    gzipped = true;
+                }
+            }
+
+            const auto connection_header = request->headers.find("connection");
+            const bool close = connection_header != request->headers.end() && to_lower(connection_header->second) == "close";
+
+            std::string head = "HTTP/1.1 " + std::to_string(response.status) + " " + reason_of(response.status) + "\r\n"
+                + "Content-Type: application/json; charset=utf-8\r\n"
+                + "Content-Length: " + std::to_string(body.size()) + "\r\n";
+            if (gzipped)
+                head += "Content-Encoding: gzip\r\n";
+            if (close)
+                head += "Connection: close\r\n";
+            for (const auto& [name, value] : response.headers)
+                head += name + ": " + value + "\r\n";
+            head += "\r\n";
+
+            std::this_thread::sleep_until(started + std::chrono::milliseconds{ emulator.latency() });
+
+            if (emulator.get_options().verbose)
+                std::cout << request->method << " " << request->path << " -> " << response.status << std::endl;
+
+            if (!connection.write(head) || !connection.write(body) || close)
+                return;
+        }
+    }
+
+    bool parse_options(int argc, char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string a = argv[i];
+            auto value = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument{ "Missing value for " + a };
+                return argv[++i];
+            };
+
+            if (a == "-h" || a == "--help")
+                return false;
+            else if (a == "-v" || a == "--verbose")
+                options.verbose = true;
+            else if (a == "--port")
+                options.port = static_cast<uint16_t>(std::stoul(value()));
+            else if (a == "--latency")
+                options.latency_ms = std::stoi(value());
+            else if (a == "--jitter")
+                options.jitter_ms = std::stoi(value());
+            else if (a == "--error-rate")
+                options.error_rate = std::stod(value());
+            else if (a == "--partial-writes")
+                options.partial_writes = true;
+            else if (a == "--rate-limit")
+                options.rate_limit = std::stoi(value());
+            else if (a == "--raindrops")
+                options.raindrops = std::stoi(value());
+            else if (a == "--collections")
+            {
+                options.collections.clear();
+                const auto list = value();
+                for (size_t begin = 0; begin <= list.size(); )
+                {
+                    auto end = list.find(',', begin);
+                    if (end == std::string::npos)
+                        end = list.size();
+                    if (end > begin)
+                        options.collections.push_back(list.substr(begin, end - begin));
+                    begin = end + 1;
+                }
+            }
+            else
+                throw std::invalid_argument{ "Unknown option " + a };
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        if (!parse_options(argc, argv, options))
+        {
+            std::cout << help_message;
+            return 0;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "[ERROR] " << e.what() << "\n" << help_message;
+        return 1;
+    }
+
+    if (options.collections.empty())
+    {
+        std::cerr << "[ERROR] At least one collection is needed" << std::endl;
+        return 1;
+    }
+
+    Emulator emulator{ options };
+    emulator.seed();
+
+    const int server = ::socket(AF_INET, SOCK_STREAM, 0);
+    const int reuse = 1;
+    ::setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(options.port);
+
+    if (::bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(server, SOMAXCONN) != 0)
+    {
+        std::cerr << "[ERROR] Could not listen on port " << options.port << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    std::cout << "Emulating raindrop.io at http://127.0.0.1:" << options.port << std::endl;
+
+    while (true)
+    {
+        const int client = ::accept(server, nullptr, nullptr);
+        if (client < 0)
+            continue;
+
+        const int no_delay = 1;
+        ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        std::thread{ serve, std::ref(emulator), client }.detach();
+    }
+}
@@ -0,0 +1,168 @@
+// Compares the directory listing backends of DirectoryWalker on a real tree. Every backend walks
+// the tree several times and the fastest and median walks are reported, along with what was found
+// so the backends can be checked to agree.
+//
+// Run it twice, or once with a warm up walk, to compare listings served from the page cache.
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <magic_enum.hpp>
+
+#include <pattern_set.h>
+#include <scanner.h>
+
+namespace
+{
+    constexpr auto help_message = R"(scan-benchmark: compares the directory listing backends of folderdrop
+
+usage: scan-benchmark [options] path
+    options:
+        -h, --help          show this message
+        --runs              walks per backend (default: 5)
+        --threads           walking threads, 0 for one per hardware thread (default: 0)
+        --flat              only list the given directory, like a non recursive mount
+        --pattern           also match the names of files against this regex, like a mount does
+)";
+
+    struct Options
+    {
+        std::string path;
+        int runs = 5;
+        int threads = 0;
+        bool recursive = true;
+        std::string pattern;
+    };
+
+    struct Counts
+    {
+        size_t regular = 0;
+        size_t directories = 0;
+        size_t other = 0;
+        size_t matched = 0;
+        size_t failures = 0;
+
+        bool operator==(const Counts& o) const
+        {
+            return regular == o.regular && directories == o.directories && other == o.other && matched == o.matched && failures == o.failures;
+        }
+    };
+
+    bool parse_count(std::string_view value, int& out)
+    {
+        const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), out);
+        return ec == std::errc{} && end == value.data() + value.size() && out >= 0;
+    }
+
+    /// @return False when the arguments are wrong or help was asked
+    bool parse_options(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string_view arg{ argv[i] };
+            const bool has_value = i + 1 < argc;
+            if (arg == "-h" || arg == "--help")
+                return false;
+            else if (arg == "--runs" && has_value)
+            {
+                if (!parse_count(argv[++i], options.runs) || options.runs == 0)
+                    return false;
+            }
+            else if (arg == "--threads" && has_value)
+            {
+                if (!parse_count(argv[++i], options.threads))
+                    return false;
+            }
+            else if (arg == "--flat")
+                options.recursive = false;
+            else if (arg == "--pattern" && has_value)
+                options.pattern = argv[++i];
+            else if (options.path.empty() && !arg.empty() && arg.front() != '-')
+                options.path = arg;
+            else
+                return false;
+        }
+        return !options.path.empty();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << help_message;
+        return 1;
+    }
+
+    std::optional<PatternSet> pattern;
+    if (!options.pattern.empty())
+        pattern.emplace(std::vector<std::string>{ options.pattern });
+
+    std::cout << std::left << std::setw(10) << "backend" << std::right << std::setw(12) << "fastest ms" << std::setw(12) << "median ms"
+        << std::setw(12) << "files" << std::setw(12) << "dirs" << std::setw(10) << "other" << std::setw(10) << "matched" << std::endl;
+
+    std::optional<Counts> reference;
+    bool agree = true;
+    for (const auto backend : { ScanBackend::iterator, ScanBackend::getdents })
+    {
+        const DirectoryWalker walker{ options.threads, options.recursive, backend };
+        std::vector<double> times;
+        Counts counts;
+
+        for (int run = 0; run < options.runs; run++)
+        {
+            std::atomic<size_t> regular{ 0 }, directories{ 0 }, other{ 0 }, matched{ 0 };
+
+            const auto start = std::chrono::steady_clock::now();
+            const auto failures = walker.walk(options.path, [&](size_t, const ScanEntry& entry)
+            {
+                switch (entry.kind)
+                {
+                    case EntryKind::regular:
+                        regular.fetch_add(1, std::memory_order_relaxed);
+                        if (pattern && pattern->matches(entry.name))
+                        {
+                            matched.fetch_add(1, std::memory_order_relaxed);
+                        }
+                        break;
+                    case EntryKind::directory:
+                        directories.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    case EntryKind::other:
+                        other.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                }
+            });
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+            counts = Counts{ regular, directories, other, matched, failures };
+        }
+
+        std::sort(times.begin(), times.end());
+        std::cout << std::left << std::setw(10) << magic_enum::enum_name(backend) << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << times.front() << std::setw(12) << times[times.size() / 2]
+            << std::setw(12) << counts.regular << std::setw(12) << counts.directories << std::setw(10) << counts.other
+            << std::setw(10) << counts.matched << std::endl;
+
+        if (reference && !(*reference == counts))
+            agree = false;
+        reference = counts;
+    }
+
+    if (!agree)
+    {
+        std::cerr << "[WARNING] The backends found different entries. Was the tree modified during the benchmark?" << std::endl;
+        return 2;
+    }
+
+    return 0;
+}